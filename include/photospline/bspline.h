@@ -39,6 +39,31 @@ void bspline_nonzero(const double* knots, const unsigned nknots,
     const double x, int left, const int n, float* values, float* derivs);
 void bspline_deriv_nonzero(const double* knots, const unsigned nknots,
     const double x, const int left, const int n, float* biatx);
+void bsplvd(const double* knots, const unsigned nknots,
+    const double x, int left, const int n, const int nderiv, float* values);
+
+/*
+ * Division-free versions of the routines above, which multiply by the
+ * reciprocals of the knot differences, computed once for a set of knots
+ * by knot_reciprocals() into recip, an array of length order*nknots. The
+ * results may differ from those of the dividing routines in their last
+ * bits. For bsplvb_reciprocal(), `left' must also satisfy
+ * jhigh-2 <= left <= nknots-jhigh.
+ */
+
+void knot_reciprocals(const double* knots, const unsigned nknots,
+    const int order, double* recip);
+void bsplvb_simple_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, double x, int left, int jhigh, float* biatx);
+void bsplvb_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, const double x, const int left, const int jlow,
+    const int jhigh, float* biatx, double* delta_l, double* delta_r);
+void bspline_nonzero_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, const double x, int left, const int n,
+    float* values, float* derivs);
+void bspline_deriv_nonzero_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, const double x, const int left, const int n,
+    float* biatx);
 
 /*
  * Evaluates the results of a full spline basis given a set of knots,
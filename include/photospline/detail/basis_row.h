@@ -0,0 +1,88 @@
+#ifndef PHOTOSPLINE_BASIS_ROW_H
+#define PHOTOSPLINE_BASIS_ROW_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+template<typename Alloc>
+uint64_t splinetable<Alloc>::evaluator::basis_row_size() const{
+	uint64_t size = 1;
+	for (uint32_t n = 0; n < table.ndim; n++)
+		size *= search[n].order + 1;
+	return(size);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::basis_row(const double* x, const int* centers, uint64_t* indices,
+                                              double* weights, int derivatives) const{
+	const uint32_t ndim = table.ndim;
+	const uint64_t* strides = &table.strides[0];
+	float localbasis_store[ndim*maxdegree];
+	detail::buffer2d<float> localbasis{localbasis_store,maxdegree};
+	fill_basis(x, centers, derivatives, localbasis);
+	
+	/*
+	 * Walk the supporting coefficients in row-major order, as
+	 * ndsplineeval_core does, keeping the products of the basis functions
+	 * and the sums of the offsets of the leading dimensions, which change
+	 * only when the position in them does. Each row along the last
+	 * dimension is then written in one pass.
+	 */
+	const uint32_t last = ndim - 1;
+	const uint32_t width = search[last].order + 1;
+	uint32_t index[ndim];
+	double product[ndim];
+	uint64_t offset[ndim];
+	product[0] = 1;
+	offset[0] = (centers[last] - search[last].order)*strides[last];
+	for (uint32_t n = 0; n < last; n++) {
+		index[n] = 0;
+		product[n+1] = product[n]*localbasis[n][0];
+		offset[n+1] = offset[n] + (centers[n] - search[n].order)*strides[n];
+	}
+	while (true) {
+		for (uint32_t i = 0; i < width; i++) {
+			indices[i] = offset[last] + i*strides[last];
+			weights[i] = product[last]*localbasis[last][i];
+		}
+		indices += width;
+		weights += width;
+		
+		//advance to the next row, carrying to earlier dimensions
+		uint32_t n = last;
+		while (n > 0 && ++index[n-1] > search[n-1].order)
+			index[--n] = 0;
+		if (n == 0)
+			break;
+		for (uint32_t j = n - 1; j < last; j++) {
+			product[j+1] = product[j]*localbasis[j][index[j]];
+			offset[j+1] = offset[j] + (centers[j] - search[j].order + index[j])*strides[j];
+		}
+	}
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::basis_rows(const double* const* coordinates, size_t npoints,
+                                               uint64_t* rowStarts, uint64_t* columns,
+                                               double* values, int derivatives) const{
+	const uint32_t ndim = table.ndim;
+	const uint64_t size = basis_row_size();
+	double x[ndim];
+	int centers[ndim];
+	uint64_t entries = 0;
+	for (size_t p = 0; p < npoints; p++) {
+		rowStarts[p] = entries;
+		for (uint32_t n = 0; n < ndim; n++)
+			x[n] = coordinates[n][p];
+		if (!searchcenters(x, centers))
+			continue;
+		basis_row(x, centers, columns + entries, values + entries, derivatives);
+		entries += size;
+	}
+	rowStarts[npoints] = entries;
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_BASIS_ROW_H
@@ -22,7 +22,11 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core(const int *centers, const
 	if (__builtin_expect(sp & 15UL, 0))
 		(void)alloca(16 - (sp & 15UL));
 #endif
-	v4sf basis_tree[ndim+1][PHOTOSPLINE_NVECS];
+	const uint32_t* order = &this->order[0];
+	const uint64_t* strides = &this->strides[0];
+	const float* coefficients = &this->coefficients[0];
+	const uint32_t nvecs = gradient_nvecs(PHOTOSPLINE_VECTOR_SIZE);
+	v4sf basis_tree[ndim+1][nvecs];
 	int decomposedposition[ndim];
 	
 	int64_t tablepos = 0;
@@ -31,7 +35,7 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core(const int *centers, const
 		tablepos += (centers[n] - order[n])*strides[n];
 	}
 	
-	for (uint32_t k = 0; k < PHOTOSPLINE_NVECS; k++) {
+	for (uint32_t k = 0; k < nvecs; k++) {
 		v4sf_init(basis_tree[0][k], 1);
 		for (uint32_t n = 0; n < ndim; n++)
 			basis_tree[n+1][k] = basis_tree[n][k]*localbasis[n][0][k];
@@ -46,7 +50,7 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core(const int *centers, const
 		for (uint32_t i = 0; __builtin_expect(i < order[ndim-1] + 1, 1); i++) {
 			v4sf weights;
 			v4sf_init(weights, coefficients[tablepos + i]);
-			for (uint32_t k = 0; k < PHOTOSPLINE_NVECS; k++)
+			for (uint32_t k = 0; k < nvecs; k++)
 				result[k] += basis_tree[ndim-1][k]*
 				localbasis[ndim-1][i][k]*weights;
 		}
@@ -67,7 +71,7 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core(const int *centers, const
 			decomposedposition[i] = 0;
 		}
 		for (uint32_t j = i; __builtin_expect(j < ndim-1, 1); j++)
-			for (uint32_t k = 0; k < PHOTOSPLINE_NVECS; k++)
+			for (uint32_t k = 0; k < nvecs; k++)
 				basis_tree[j+1][k] = basis_tree[j][k]*
 				localbasis[j][decomposedposition[j]][k];
 	}
@@ -94,6 +98,9 @@ void splinetable<Alloc>::ndsplineeval_multibasis_coreD(const int *centers, const
 	if (__builtin_expect(sp & 15UL, 0))
 		(void)alloca(16 - (sp & 15UL));
 #endif
+	const uint32_t* order = &this->order[0];
+	const uint64_t* strides = &this->strides[0];
+	const float* coefficients = &this->coefficients[0];
 	const unsigned int VC=vectorCountHelper<D>::VC;
 	v4sf basis_tree[D+1][VC];
 	int decomposedposition[D];
@@ -162,6 +169,8 @@ void splinetable<Alloc>::ndsplineeval_multibasis_coreD_FixedOrder(const int *cen
 	if (__builtin_expect(sp & 15UL, 0))
 		(void)alloca(16 - (sp & 15UL));
 #endif
+	const uint64_t* strides = &this->strides[0];
+	const float* coefficients = &this->coefficients[0];
 	const unsigned int VC=vectorCountHelper<D>::VC;
 	v4sf basis_tree[D+1][VC];
 	int decomposedposition[D];
@@ -233,7 +242,10 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core_KnownOrder(const int *cent
 	if (__builtin_expect(sp & 15UL, 0))
 		(void)alloca(16 - (sp & 15UL));
 #endif
+	const uint64_t* strides = &this->strides[0];
+	const float* coefficients = &this->coefficients[0];
 	constexpr unsigned int D = sizeof...(Orders);
+	const unsigned int* knownOrder = detail::order_list<Orders...>::values;
 	const unsigned int VC=vectorCountHelper<D>::VC;
 	v4sf basis_tree[D+1][VC];
 	int decomposedposition[D];
@@ -241,7 +253,7 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core_KnownOrder(const int *cent
 	int64_t tablepos = 0;
 	for (uint32_t n = 0; n < D; n++) {
 		decomposedposition[n] = 0;
-		tablepos += (centers[n] - order[n])*strides[n];
+		tablepos += (centers[n] - (int64_t)knownOrder[n])*(int64_t)strides[n];
 	}
 	
 	for (uint32_t k = 0; k < VC; k++) {
@@ -277,7 +289,7 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core_KnownOrder(const int *cent
 		
 		/* Carry to higher dimensions */
 		uint32_t i;
-		for (i = D-2; decomposedposition[i] > order[i]; i--) {
+		for (i = D-2; decomposedposition[i] > (int)knownOrder[i]; i--) {
 			decomposedposition[i-1]++;
 			tablepos += (strides[i-1] - decomposedposition[i]*strides[i]);
 			decomposedposition[i] = 0;
@@ -288,6 +300,225 @@ void splinetable<Alloc>::ndsplineeval_multibasis_core_KnownOrder(const int *cent
 				localbasis[j][decomposedposition[j]][k];
 	}
 }
+
+/*
+ * Gradient evaluation for coefficients which are tiled, or stored as a type
+ * Coeff other than float, which finds the positions of the coefficients as
+ * ndsplineeval_core_offsets does. The coefficients are converted to float,
+ * including double ones. A D or O of zero means that the number of
+ * dimensions or the order is taken from the table at runtime.
+ */
+template <typename Alloc>
+template <unsigned int D, unsigned int O, typename Coeff>
+void splinetable<Alloc>::ndsplineeval_multibasis_core_offsets(const int *centers, const v4sf*** localbasis, v4sf* result) const{
+#if (defined(__i386__) || defined (__x86_64__)) && defined(__ELF__)
+	/*
+	 * Work around GCC ABI-compliance issue with SSE on x86 by
+	 * forcibly realigning the stack to a 16-byte boundary.
+	 */
+	volatile register unsigned long sp __asm("esp");
+	if (__builtin_expect(sp & 15UL, 0))
+		(void)alloca(16 - (sp & 15UL));
+#endif
+	const detail::coefficient_reader<Coeff> coefficient = stored_coefficients<Coeff>();
+	const uint32_t* order = &this->order[0];
+	const uint32_t nd = (D ? D : ndim);
+	const unsigned int VC = (D ? vectorCountHelper<D>::VC : gradient_nvecs(PHOTOSPLINE_VECTOR_SIZE));
+	v4sf basis_tree[nd+1][VC];
+	int decomposedposition[nd];
+	const uint64_t* offsets[nd];
+	uint64_t tablepos[nd];
+	
+	for (uint32_t n = 0; n < nd; n++) {
+		decomposedposition[n] = 0;
+		offsets[n] = &coefficient_offsets[n][centers[n] - (O ? O : order[n])];
+	}
+	
+	for (uint32_t k = 0; k < VC; k++) {
+		v4sf_init(basis_tree[0][k], 1);
+		for (uint32_t n = 0; n < nd; n++)
+			basis_tree[n+1][k] = basis_tree[n][k]*localbasis[n][0][k];
+	}
+	tablepos[0] = 0;
+	for (uint32_t n = 0; n + 1 < nd; n++)
+		tablepos[n+1] = tablepos[n] + offsets[n][0];
+	
+	uint32_t nchunks = 1;
+	for (uint32_t n = 0; n + 1 < nd; n++)
+		nchunks *= (O ? O : order[n]) + 1;
+	const uint32_t chunk = (O ? O : order[nd-1]) + 1;
+	const uint64_t* lastoffsets = offsets[nd-1];
+	
+	uint32_t n = 0;
+	while (1) {
+		for (uint32_t i = 0; __builtin_expect(i < chunk, 1); i++) {
+			v4sf weights;
+			v4sf_init(weights, (float)coefficient(tablepos[nd-1] + lastoffsets[i]));
+			for (uint32_t k = 0; k < VC; k++)
+				result[k] += basis_tree[nd-1][k]*localbasis[nd-1][i][k]*weights;
+		}
+		
+		if (__builtin_expect(++n == nchunks, 0))
+			break;
+		
+		decomposedposition[nd-2]++;
+		
+		/* Carry to higher dimensions */
+		uint32_t i;
+		for (i = nd-2; decomposedposition[i] > (O ? O : order[i]); i--) {
+			decomposedposition[i-1]++;
+			decomposedposition[i] = 0;
+		}
+		for (uint32_t j = i; __builtin_expect(j < nd-1, 1); j++) {
+			for (uint32_t k = 0; k < VC; k++)
+				basis_tree[j+1][k] = basis_tree[j][k]*
+				localbasis[j][decomposedposition[j]][k];
+			tablepos[j+1] = tablepos[j] + offsets[j][decomposedposition[j]];
+		}
+	}
+}
+
+template <typename Alloc>
+void splinetable<Alloc>::ndsplineeval_multibasis_core_stored(const int *centers, const v4sf*** localbasis, v4sf* result) const{
+	switch(storage){
+		case coefficient_storage::float16:
+			ndsplineeval_multibasis_core_offsets<0,0,detail::half>(centers, localbasis, result);
+			break;
+		case coefficient_storage::bfloat16:
+			ndsplineeval_multibasis_core_offsets<0,0,detail::bfloat16>(centers, localbasis, result);
+			break;
+		case coefficient_storage::float64:
+			ndsplineeval_multibasis_core_offsets<0,0,double>(centers, localbasis, result);
+			break;
+		case coefficient_storage::int8:
+			ndsplineeval_multibasis_core_offsets<0,0,detail::block_quantized<int8_t>>(centers, localbasis, result);
+			break;
+		case coefficient_storage::int16:
+			ndsplineeval_multibasis_core_offsets<0,0,detail::block_quantized<int16_t>>(centers, localbasis, result);
+			break;
+		default:
+			if (coefficient_offsets)
+				ndsplineeval_multibasis_core_offsets<0,0,float>(centers, localbasis, result);
+			else
+				ndsplineeval_multibasis_core(centers, localbasis, result);
+	}
+}
+
+#ifdef PHOTOSPLINE_SIMD_DISPATCH
+/*
+ * Body of the gradient evaluation kernels for vectors of type Vec, which
+ * views each row of localbasis and the result as arrays of (unaligned) Vec
+ * rather than of v4sf.
+ * A D or O of zero means that the number of dimensions or the order is
+ * taken from the table at runtime. This is always inlined into wrappers
+ * which are compiled for the instruction set that Vec needs.
+ *
+ * Each lane does the same operations in the same order as in the v4sf
+ * kernels, so as long as no fused multiply-adds are generated (the AVX2
+ * wrapper does not enable FMA), the results are identical to theirs.
+ */
+template <typename Alloc>
+template <typename Vec, unsigned int D, unsigned int O>
+inline __attribute__((always_inline))
+void splinetable<Alloc>::ndsplineeval_multibasis_core_wide(const int *centers, const v4sf*** localbasis, v4sf* result) const{
+	const uint32_t* order = &this->order[0];
+	const uint64_t* strides = &this->strides[0];
+	const float* coefficients = &this->coefficients[0];
+	typedef typename detail::unaligned_vector<Vec>::type VecU;
+	const uint32_t nd = (D ? D : ndim);
+	//the number of vectors needed for the value and gradient, which is a
+	//compile-time constant when the dimension is, so that the accumulators
+	//stay in registers
+	constexpr uint32_t W = sizeof(Vec)/sizeof(float);
+	const uint32_t VC = (D ? (D + W)/W : (nd + W)/W);
+	Vec basis_tree[nd+1][VC];
+	int decomposedposition[nd];
+	//accumulate in registers rather than through result, which may alias
+	//the coefficients
+	Vec acc[VC];
+	
+	int64_t tablepos = 0;
+	for (uint32_t n = 0; n < nd; n++) {
+		decomposedposition[n] = 0;
+		tablepos += (centers[n] - (int64_t)(O ? O : order[n]))*(int64_t)strides[n];
+	}
+	
+	for (uint32_t k = 0; k < VC; k++) {
+		acc[k] = ((VecU*)result)[k];
+		basis_tree[0][k] = Vec{} + 1.f;
+		for (uint32_t n = 0; n < nd; n++)
+			basis_tree[n+1][k] = basis_tree[n][k]*((const VecU*)localbasis[n][0])[k];
+	}
+	
+	uint32_t nchunks = 1;
+	for (uint32_t n = 0; n < nd - 1; n++)
+		nchunks *= ((O ? O : order[n]) + 1);
+	const uint32_t chunk = (O ? O : order[nd-1]) + 1;
+	
+	uint32_t n = 0;
+	while (1) {
+		for (uint32_t i = 0; __builtin_expect(i < chunk, 1); i++) {
+			Vec weights = Vec{} + coefficients[tablepos + i];
+			for (uint32_t k = 0; k < VC; k++)
+				acc[k] += basis_tree[nd-1][k]*
+				((const VecU*)localbasis[nd-1][i])[k]*weights;
+		}
+		
+		if (__builtin_expect(++n == nchunks, 0)) {
+			for (uint32_t k = 0; k < VC; k++)
+				((VecU*)result)[k] = acc[k];
+			break;
+		}
+		
+		tablepos += strides[nd-2];
+		decomposedposition[nd-2]++;
+		
+		/* Carry to higher dimensions */
+		uint32_t i;
+		for (i = nd-2; decomposedposition[i] > (O ? O : order[i]); i--) {
+			decomposedposition[i-1]++;
+			tablepos += (strides[i-1] - decomposedposition[i]*strides[i]);
+			decomposedposition[i] = 0;
+		}
+		for (uint32_t j = i; __builtin_expect(j < nd-1, 1); j++)
+			for (uint32_t k = 0; k < VC; k++)
+				basis_tree[j+1][k] = basis_tree[j][k]*
+				((const VecU*)localbasis[j][decomposedposition[j]])[k];
+	}
+}
+
+template <typename Alloc>
+template <unsigned int D, unsigned int O>
+__attribute__((target("avx2")))
+void splinetable<Alloc>::ndsplineeval_multibasis_core_avx2(const int *centers, const v4sf*** localbasis, v4sf* result) const{
+	ndsplineeval_multibasis_core_wide<detail::v8sf,D,O>(centers, localbasis, result);
+}
+
+template <typename Alloc>
+template <unsigned int D, unsigned int O>
+__attribute__((target("avx512f")))
+void splinetable<Alloc>::ndsplineeval_multibasis_core_avx512(const int *centers, const v4sf*** localbasis, v4sf* result) const{
+	ndsplineeval_multibasis_core_wide<detail::v16sf,D,O>(centers, localbasis, result);
+}
+
+template <typename Alloc>
+template <unsigned int D>
+typename splinetable<Alloc>::multibasis_kernel
+splinetable<Alloc>::simd_multibasis_kernel(simd_variant variant, uint32_t constOrder){
+	if (variant == simd_variant::avx512) {
+		switch (constOrder) {
+			case 2: return(&splinetable::ndsplineeval_multibasis_core_avx512<D,2>);
+			case 3: return(&splinetable::ndsplineeval_multibasis_core_avx512<D,3>);
+			default: return(&splinetable::ndsplineeval_multibasis_core_avx512<D,0>);
+		}
+	}
+	switch (constOrder) {
+		case 2: return(&splinetable::ndsplineeval_multibasis_core_avx2<D,2>);
+		case 3: return(&splinetable::ndsplineeval_multibasis_core_avx2<D,3>);
+		default: return(&splinetable::ndsplineeval_multibasis_core_avx2<D,0>);
+	}
+}
+#endif
 	
 /* Evaluate the spline surface and all its derivatives at x */
 
@@ -297,18 +528,15 @@ splinetable<Alloc>::ndsplineeval_gradient(const double* x, const int* centers, d
 {
 	uint32_t maxdegree = *std::max_element(order,order+ndim) + 1;
 	uint32_t nbases = ndim + 1;
-	v4sf acc[PHOTOSPLINE_NVECS];
+	uint32_t nvecs = gradient_nvecs(PHOTOSPLINE_VECTOR_SIZE);
+	v4sf acc[nvecs];
 	float valbasis[maxdegree];
 	float gradbasis[maxdegree];
-	v4sf localbasis[ndim][maxdegree][PHOTOSPLINE_NVECS];
+	v4sf localbasis[ndim][maxdegree][nvecs];
 	const v4sf* localbasis_rowptr[ndim][maxdegree];
 	const v4sf** localbasis_ptr[ndim];
 
 	assert(ndim > 0);
-	if (ndim+1 > PHOTOSPLINE_MAXDIM)
-		throw std::runtime_error("Error: ndsplineeval_gradient() can only "
-		    "process up to "+std::to_string(PHOTOSPLINE_MAXDIM-1)+"-dimensional tables. "
-		    "Adjust PHOTOSPLINE_MAXDIM in detail/simd.h to change this.");
 		
 	for (uint32_t n = 0; n < ndim; n++) {
 
@@ -329,6 +557,8 @@ splinetable<Alloc>::ndsplineeval_gradient(const double* x, const int* centers, d
 				else
 					((float*)(localbasis[n][i]))[j] = valbasis[i];
 			}
+			for (uint32_t j = ndim+1; j < nvecs*PHOTOSPLINE_VECTOR_SIZE; j++)
+				((float*)(localbasis[n][i]))[j] = 0;
 			
 			localbasis_rowptr[n][i] = localbasis[n][i];
 		}
@@ -338,10 +568,10 @@ splinetable<Alloc>::ndsplineeval_gradient(const double* x, const int* centers, d
 
 	float* acc_ptr = (float*)acc;
 
-	for (uint32_t i = 0; i < nbases; i++)
+	for (uint32_t i = 0; i < nvecs*PHOTOSPLINE_VECTOR_SIZE; i++)
 		acc_ptr[i] = 0;
 
-	ndsplineeval_multibasis_core(centers, localbasis_ptr, acc);
+	ndsplineeval_multibasis_core_stored(centers, localbasis_ptr, acc);
 
 	for (uint32_t i = 0; i < nbases; i++)
 		evaluates[i] = acc_ptr[i];
@@ -349,20 +579,15 @@ splinetable<Alloc>::ndsplineeval_gradient(const double* x, const int* centers, d
 
 template<typename Alloc>
 void splinetable<Alloc>::evaluator::ndsplineeval_gradient(const double* x, const int* centers, double* evaluates) const{
-	uint32_t maxdegree = *std::max_element(table.order,table.order+table.ndim) + 1;
 	uint32_t nbases = table.ndim + 1;
-	v4sf acc[PHOTOSPLINE_NVECS];
+	v4sf acc[nvecs];
 	float valbasis[maxdegree];
 	float gradbasis[maxdegree];
-	v4sf localbasis[table.ndim][maxdegree][PHOTOSPLINE_NVECS];
+	v4sf localbasis[table.ndim][maxdegree][nvecs];
 	const v4sf* localbasis_rowptr[table.ndim][maxdegree];
 	const v4sf** localbasis_ptr[table.ndim];
 	
 	assert(table.ndim > 0);
-	if (table.ndim+1 > PHOTOSPLINE_MAXDIM)
-		throw std::runtime_error("Error: ndsplineeval_gradient() can only "
-								 "process up to "+std::to_string(PHOTOSPLINE_MAXDIM-1)+"-dimensional tables. "
-								 "Adjust PHOTOSPLINE_MAXDIM in detail/simd.h to change this.");
 	
 	for (uint32_t n = 0; n < table.ndim; n++) {
 		
@@ -370,10 +595,14 @@ void splinetable<Alloc>::evaluator::ndsplineeval_gradient(const double* x, const
 		 * Compute the values and derivatives of the table->order[n]+1 non-zero
 		 * splines at x[n], filling them into valbasis and gradbasis.
 		 */
-		bspline_nonzero(&*table.knots[n], table.nknots[n],
-						x[n], centers[n], table.order[n], valbasis, gradbasis);
+		if (!reciprocals.empty())
+			bspline_nonzero_reciprocal(search[n].knots, reciprocals[n].data(), search[n].nknots,
+			                           x[n], centers[n], search[n].order, valbasis, gradbasis);
+		else
+			bspline_nonzero(search[n].knots, search[n].nknots,
+							x[n], centers[n], search[n].order, valbasis, gradbasis);
 		
-		for (uint32_t i = 0; i <= table.order[n]; i++) {
+		for (uint32_t i = 0; i <= search[n].order; i++) {
 			
 			((float*)(localbasis[n][i]))[0] = valbasis[i];
 			
@@ -383,6 +612,8 @@ void splinetable<Alloc>::evaluator::ndsplineeval_gradient(const double* x, const
 				else
 					((float*)(localbasis[n][i]))[j] = valbasis[i];
 			}
+			for (uint32_t j = table.ndim+1; j < nvecs*PHOTOSPLINE_VECTOR_SIZE; j++)
+				((float*)(localbasis[n][i]))[j] = 0;
 			
 			localbasis_rowptr[n][i] = localbasis[n][i];
 		}
@@ -392,7 +623,7 @@ void splinetable<Alloc>::evaluator::ndsplineeval_gradient(const double* x, const
 	
 	float* acc_ptr = (float*)acc;
 	
-	for (uint32_t i = 0; i < nbases; i++)
+	for (uint32_t i = 0; i < nvecs*PHOTOSPLINE_VECTOR_SIZE; i++)
 		acc_ptr[i] = 0;
 	
 	(table.*(v_eval_ptr))(centers, localbasis_ptr, acc);
@@ -401,6 +632,253 @@ void splinetable<Alloc>::evaluator::ndsplineeval_gradient(const double* x, const
 		evaluates[i] = acc_ptr[i];
 }
 
+/*
+ * Accumulate an arbitrary number of quantities, one per lane, such as the
+ * value, gradient and Hessian of the spline, or a chosen set of partial
+ * derivatives. Each row of the basis has nvecs vectors, enough for all of
+ * the quantities. The coefficients may be stored in any layout and as any
+ * type Coeff. An O of zero means that the orders are taken from the table
+ * at runtime.
+ */
+template <typename Alloc>
+template <unsigned int O, typename Coeff>
+void splinetable<Alloc>::ndsplineeval_multibasis_core_n(const int *centers, const v4sf*** localbasis, uint32_t nvecs, v4sf* result) const{
+#if (defined(__i386__) || defined (__x86_64__)) && defined(__ELF__)
+	/*
+	 * Work around GCC ABI-compliance issue with SSE on x86 by
+	 * forcibly realigning the stack to a 16-byte boundary.
+	 */
+	volatile register unsigned long sp __asm("esp");
+	if (__builtin_expect(sp & 15UL, 0))
+		(void)alloca(16 - (sp & 15UL));
+#endif
+	const detail::coefficient_reader<Coeff> coefficient = stored_coefficients<Coeff>();
+	const uint32_t* order = &this->order[0];
+	v4sf basis_tree[ndim+1][nvecs];
+	int decomposedposition[ndim];
+	uint64_t tablepos[ndim];
+	//the position in storage of the jth supported coefficient along
+	//dimension n, which is summed over the dimensions
+	const uint32_t maxwidth = (O ? O : *std::max_element(order,order+ndim)) + 1;
+	uint64_t position_store[ndim*maxwidth];
+	detail::buffer2d<uint64_t> position{position_store,maxwidth};
+	for (uint32_t n = 0; n < ndim; n++) {
+		decomposedposition[n] = 0;
+		coefficient_positions(n, centers[n] - (O ? O : order[n]), (O ? O : order[n]) + 1, position[n]);
+	}
+	
+	for (uint32_t k = 0; k < nvecs; k++) {
+		v4sf_init(basis_tree[0][k], 1);
+		for (uint32_t n = 0; n < ndim; n++)
+			basis_tree[n+1][k] = basis_tree[n][k]*localbasis[n][0][k];
+	}
+	tablepos[0] = 0;
+	for (uint32_t n = 0; n + 1 < ndim; n++)
+		tablepos[n+1] = tablepos[n] + position[n][0];
+	
+	uint32_t nchunks = 1;
+	for (uint32_t n = 0; n + 1 < ndim; n++)
+		nchunks *= (O ? O : order[n]) + 1;
+	const uint32_t chunk = (O ? O : order[ndim-1]) + 1;
+	const uint64_t* lastpos = position[ndim-1];
+	
+	uint32_t n = 0;
+	while (1) {
+		for (uint32_t i = 0; __builtin_expect(i < chunk, 1); i++) {
+			v4sf weights;
+			v4sf_init(weights, (float)coefficient(tablepos[ndim-1] + lastpos[i]));
+			for (uint32_t k = 0; k < nvecs; k++)
+				result[k] += basis_tree[ndim-1][k]*localbasis[ndim-1][i][k]*weights;
+		}
+		
+		if (__builtin_expect(++n == nchunks, 0))
+			break;
+		
+		decomposedposition[ndim-2]++;
+		
+		/* Carry to higher dimensions */
+		uint32_t i;
+		for (i = ndim-2; decomposedposition[i] > (O ? O : order[i]); i--) {
+			decomposedposition[i-1]++;
+			decomposedposition[i] = 0;
+		}
+		for (uint32_t j = i; __builtin_expect(j < ndim-1, 1); j++) {
+			for (uint32_t k = 0; k < nvecs; k++)
+				basis_tree[j+1][k] = basis_tree[j][k]*
+				localbasis[j][decomposedposition[j]][k];
+			tablepos[j+1] = tablepos[j] + position[j][decomposedposition[j]];
+		}
+	}
+}
+
+template <typename Alloc>
+typename splinetable<Alloc>::multibasis_n_kernel
+splinetable<Alloc>::select_multibasis_n_kernel(uint32_t constOrder) const{
+	switch(storage){
+		case coefficient_storage::float16:
+			return(&splinetable::ndsplineeval_multibasis_core_n<0,detail::half>);
+		case coefficient_storage::bfloat16:
+			return(&splinetable::ndsplineeval_multibasis_core_n<0,detail::bfloat16>);
+		case coefficient_storage::float64:
+			return(&splinetable::ndsplineeval_multibasis_core_n<0,double>);
+		case coefficient_storage::int8:
+			return(&splinetable::ndsplineeval_multibasis_core_n<0,detail::block_quantized<int8_t>>);
+		case coefficient_storage::int16:
+			return(&splinetable::ndsplineeval_multibasis_core_n<0,detail::block_quantized<int16_t>>);
+		default:
+			break;
+	}
+#ifndef PHOTOSPLINE_NO_EVAL_TEMPLATES
+	switch(constOrder){
+		case 2: return(&splinetable::ndsplineeval_multibasis_core_n<2,float>);
+		case 3: return(&splinetable::ndsplineeval_multibasis_core_n<3,float>);
+	}
+#else
+	(void)constOrder;
+#endif
+	return(&splinetable::ndsplineeval_multibasis_core_n<0,float>);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluate_hessian(const double* x, const int* centers, double* evaluates, multibasis_n_kernel kernel,
+                                          const detail::knot_search* search) const{
+	const uint32_t* order = &this->order[0];
+	uint32_t maxdegree = *std::max_element(order,order+ndim) + 1;
+	uint32_t nbases = hessian_size();
+	uint32_t nvecs = (nbases + PHOTOSPLINE_VECTOR_SIZE - 1)/PHOTOSPLINE_VECTOR_SIZE;
+	v4sf acc[nvecs];
+	float bases[3][maxdegree];
+	v4sf localbasis[ndim][maxdegree][nvecs];
+	const v4sf* localbasis_rowptr[ndim][maxdegree];
+	const v4sf** localbasis_ptr[ndim];
+	
+	assert(ndim > 0);
+	
+	for (uint32_t n = 0; n < ndim; n++) {
+		
+		/*
+		 * Compute the values, first and second derivatives of the
+		 * table->order[n]+1 non-zero splines at x[n].
+		 */
+		float derivs[3*(order[n]+1)];
+		if (search)
+			bsplvd(search[n].knots, search[n].nknots, x[n], centers[n], order[n], 2, derivs);
+		else
+			bsplvd(&knots[n][0], nknots[n], x[n], centers[n], order[n], 2, derivs);
+		for (uint32_t d = 0; d < 3; d++)
+			std::copy_n(derivs + d*(order[n]+1), order[n]+1, bases[d]);
+		
+		/*
+		 * Each quantity is differentiated with respect to x[n] as many
+		 * times as n appears among the dimensions it is differentiated in.
+		 */
+		for (uint32_t i = 0; i <= order[n]; i++) {
+			float* lanes = (float*)(localbasis[n][i]);
+			uint32_t lane = 0;
+			lanes[lane++] = bases[0][i];
+			for (uint32_t a = 0; a < ndim; a++)
+				lanes[lane++] = bases[a == n][i];
+			for (uint32_t a = 0; a < ndim; a++) {
+				for (uint32_t b = a; b < ndim; b++)
+					lanes[lane++] = bases[(a == n) + (b == n)][i];
+			}
+			for (; lane < nvecs*PHOTOSPLINE_VECTOR_SIZE; lane++)
+				lanes[lane] = 0;
+			
+			localbasis_rowptr[n][i] = localbasis[n][i];
+		}
+		
+		localbasis_ptr[n] = localbasis_rowptr[n];
+	}
+	
+	float* acc_ptr = (float*)acc;
+	
+	for (uint32_t i = 0; i < nvecs*PHOTOSPLINE_VECTOR_SIZE; i++)
+		acc_ptr[i] = 0;
+	
+	(this->*kernel)(centers, localbasis_ptr, nvecs, acc);
+	
+	for (uint32_t i = 0; i < nbases; i++)
+		evaluates[i] = acc_ptr[i];
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluate_multi(const double* x, const int* centers, const int* derivatives, uint32_t nderivs,
+                                        double* evaluates, multibasis_n_kernel kernel,
+                                        const detail::knot_search* search) const{
+	if (nderivs == 0)
+		return;
+	const uint32_t* order = &this->order[0];
+	uint32_t maxdegree = *std::max_element(order,order+ndim) + 1;
+	uint32_t nvecs = (nderivs + PHOTOSPLINE_VECTOR_SIZE - 1)/PHOTOSPLINE_VECTOR_SIZE;
+	v4sf acc[nvecs];
+	float bases[2][maxdegree];
+	v4sf localbasis[ndim][maxdegree][nvecs];
+	const v4sf* localbasis_rowptr[ndim][maxdegree];
+	const v4sf** localbasis_ptr[ndim];
+	
+	assert(ndim > 0);
+	
+	for (uint32_t n = 0; n < ndim; n++) {
+		
+		/*
+		 * Compute the values and derivatives of the table->order[n]+1
+		 * non-zero splines at x[n], and give each quantity whichever of
+		 * these its mask asks for.
+		 */
+		if (search)
+			bspline_nonzero(search[n].knots, search[n].nknots,
+			    x[n], centers[n], order[n], bases[0], bases[1]);
+		else
+			bspline_nonzero(&*knots[n], nknots[n],
+			    x[n], centers[n], order[n], bases[0], bases[1]);
+		
+		for (uint32_t i = 0; i <= order[n]; i++) {
+			float* lanes = (float*)(localbasis[n][i]);
+			for (uint32_t j = 0; j < nderivs; j++)
+				lanes[j] = bases[(derivatives[j] >> n) & 1][i];
+			for (uint32_t j = nderivs; j < nvecs*PHOTOSPLINE_VECTOR_SIZE; j++)
+				lanes[j] = 0;
+			
+			localbasis_rowptr[n][i] = localbasis[n][i];
+		}
+		
+		localbasis_ptr[n] = localbasis_rowptr[n];
+	}
+	
+	float* acc_ptr = (float*)acc;
+	
+	for (uint32_t i = 0; i < nvecs*PHOTOSPLINE_VECTOR_SIZE; i++)
+		acc_ptr[i] = 0;
+	
+	(this->*kernel)(centers, localbasis_ptr, nvecs, acc);
+	
+	for (uint32_t i = 0; i < nderivs; i++)
+		evaluates[i] = acc_ptr[i];
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::ndsplineeval_hessian(const double* x, const int* centers, double* evaluates) const{
+	evaluate_hessian(x, centers, evaluates, select_multibasis_n_kernel(0), NULL);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::ndsplineeval_hessian(const double* x, const int* centers, double* evaluates) const{
+	table.evaluate_hessian(x, centers, evaluates, n_eval_ptr, &search[0]);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::ndsplineeval_multi(const double* x, const int* centers, const int* derivatives,
+                                            uint32_t nderivs, double* evaluates) const{
+	evaluate_multi(x, centers, derivatives, nderivs, evaluates, select_multibasis_n_kernel(0), NULL);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::ndsplineeval_multi(const double* x, const int* centers, const int* derivatives,
+                                                       uint32_t nderivs, double* evaluates) const{
+	table.evaluate_multi(x, centers, derivatives, nderivs, evaluates, n_eval_ptr, &search[0]);
+}
+
 } //namespace photospline
 
 #endif
@@ -0,0 +1,156 @@
+#ifndef PHOTOSPLINE_COEFFICIENT_STORAGE_H
+#define PHOTOSPLINE_COEFFICIENT_STORAGE_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace photospline{
+
+///The types in which spline coefficients may be stored in memory
+enum class coefficient_storage{
+	float32, ///< single precision, as in FITS files
+	float16, ///< IEEE 754 half precision
+	bfloat16, ///< the upper half of single precision, with its full range
+	float64, ///< double precision
+	int8, ///< 8-bit integers, with a scale and offset for each tile
+	int16 ///< 16-bit integers, with a scale and offset for each tile
+};
+
+///Check whether a coefficient storage type is quantized in tiles
+inline bool is_quantized(coefficient_storage storage){
+	return(storage==coefficient_storage::int8 || storage==coefficient_storage::int16);
+}
+
+///Get the number of bytes in which each coefficient is stored
+inline size_t coefficient_storage_size(coefficient_storage storage){
+	switch(storage){
+		case coefficient_storage::float16: return(2);
+		case coefficient_storage::bfloat16: return(2);
+		case coefficient_storage::float64: return(8);
+		case coefficient_storage::int8: return(1);
+		case coefficient_storage::int16: return(2);
+		default: return(4);
+	}
+}
+
+///Get a human-readable name for a coefficient storage type
+inline const char* coefficient_storage_name(coefficient_storage storage){
+	switch(storage){
+		case coefficient_storage::float16: return("float16");
+		case coefficient_storage::bfloat16: return("bfloat16");
+		case coefficient_storage::float64: return("float64");
+		case coefficient_storage::int8: return("int8");
+		case coefficient_storage::int16: return("int16");
+		default: return("float32");
+	}
+}
+
+namespace detail{
+
+///A coefficient stored in IEEE 754 half precision
+struct half{ uint16_t bits; };
+///A coefficient stored in bfloat16 format
+struct bfloat16{ uint16_t bits; };
+
+inline uint32_t float_bits(float f){
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	return(bits);
+}
+
+inline float bits_float(uint32_t bits){
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return(f);
+}
+
+///Get the value of a stored coefficient, in the type used to evaluate with it
+inline float coefficient_value(float c){ return(c); }
+inline double coefficient_value(double c){ return(c); }
+inline float coefficient_value(bfloat16 c){ return(bits_float(uint32_t(c.bits) << 16)); }
+inline float coefficient_value(half c){
+	uint32_t sign = uint32_t(c.bits & 0x8000u) << 16;
+	uint32_t magnitude = c.bits & 0x7fffu;
+	//Move the exponent and mantissa into place, and scale by 2^112 to
+	//correct the exponent bias. This is exact, and also normalizes
+	//subnormal values.
+	float f = bits_float(magnitude << 13)*bits_float((127u + 112u) << 23);
+	if (magnitude >= 0x7c00u) //infinity or NaN
+		f = bits_float(0x7f800000u | (magnitude << 13));
+	return(bits_float(float_bits(f) | sign));
+}
+
+///Store a value as a coefficient, rounding to the nearest representable
+///value, with ties to even
+inline void store_coefficient(double value, float& c){ c = value; }
+inline void store_coefficient(double value, double& c){ c = value; }
+inline void store_coefficient(double value, bfloat16& c){
+	uint32_t bits = float_bits(value);
+	if ((bits & 0x7fffffffu) > 0x7f800000u) //keep NaNs quiet
+		c.bits = (bits >> 16) | 0x40u;
+	else
+		c.bits = (bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16;
+}
+inline void store_coefficient(double value, half& c){
+	uint32_t bits = float_bits(value);
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	uint32_t magnitude = bits & 0x7fffffffu;
+	if (magnitude >= 0x7f800000u) //infinity or NaN
+		c.bits = sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u);
+	else if (magnitude >= 0x477ff000u) //rounds beyond the largest half, 65504
+		c.bits = sign | 0x7c00u;
+	else if (magnitude < 0x38800000u) { //subnormal as a half
+		//adding one half leaves the value in units of the smallest
+		//subnormal half, 2^-24, in the low bits, rounded by the addition
+		c.bits = sign | (float_bits(bits_float(magnitude) + 0.5f) - 0x3f000000u);
+	} else {
+		//rebias the exponent and round away the low 13 bits of the mantissa
+		magnitude += ((15u - 127u) << 23) + 0xfffu + ((magnitude >> 13) & 1u);
+		c.bits = sign | (magnitude >> 13);
+	}
+}
+
+///A coefficient quantized to an integer, which is decoded with the scale
+///and offset of its tile
+template<typename Int>
+struct block_quantized{ Int value; };
+
+///Reads stored coefficients of type Coeff, given their positions
+template<typename Coeff>
+struct coefficient_reader{
+	typedef decltype(coefficient_value(Coeff())) value_type;
+	const Coeff* data;
+	
+	coefficient_reader(const char* data, const float*, uint32_t):
+	data(reinterpret_cast<const Coeff*>(data)){}
+	value_type operator()(uint64_t pos) const{ return(coefficient_value(data[pos])); }
+	///The address of the stored value of a coefficient
+	const void* address(uint64_t pos) const{ return(data + pos); }
+};
+
+///Reads quantized coefficients, whose positions hold the index of their
+///tile above the lowest shift bits, and their position in storage in those
+template<typename Int>
+struct coefficient_reader<block_quantized<Int>>{
+	typedef float value_type;
+	const Int* data;
+	///the scale and offset of each tile, interleaved
+	const float* blocks;
+	uint32_t shift;
+	uint64_t mask;
+	
+	coefficient_reader(const char* data, const float* blocks, uint32_t shift):
+	data(reinterpret_cast<const Int*>(data)),blocks(blocks),shift(shift),
+	mask((uint64_t(1) << shift) - 1){}
+	value_type operator()(uint64_t pos) const{
+		const float* block = blocks + 2*(pos >> shift);
+		return(block[0]*data[pos & mask] + block[1]);
+	}
+	///The address of the stored value of a coefficient
+	const void* address(uint64_t pos) const{ return(data + (pos & mask)); }
+};
+
+} //namespace detail
+} //namespace photospline
+
+#endif //PHOTOSPLINE_COEFFICIENT_STORAGE_H
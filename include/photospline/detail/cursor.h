@@ -0,0 +1,139 @@
+#ifndef PHOTOSPLINE_CURSOR_H
+#define PHOTOSPLINE_CURSOR_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+template<typename Alloc>
+splinetable<Alloc>::evaluator::cursor::cursor(const evaluator& eval, int derivatives):
+eval(eval),derivatives(derivatives),
+maxdegree(eval.maxdegree),
+coordinates(eval.table.ndim),centers(eval.table.ndim),inside(eval.table.ndim,false),
+localbasis(eval.table.ndim*maxdegree),products(eval.table.ndim),positions(eval.table.ndim),
+stale(0){
+	const splinetable<Alloc>& table = eval.table;
+	for (uint32_t n = 0; n < table.ndim; n++)
+		centers[n] = eval.search[n].order;
+	products[0].assign(1, 1.f);
+	positions[0].assign(1, 0);
+	for (uint32_t n = 0; n + 1 < table.ndim; n++) {
+		products[n+1].resize(products[n].size()*(eval.search[n].order + 1));
+		positions[n+1].resize(products[n+1].size());
+	}
+}
+
+template<typename Alloc>
+bool splinetable<Alloc>::evaluator::cursor::set_coordinate(uint32_t dim, double x){
+	const splinetable<Alloc>& table = eval.table;
+	if (dim >= table.ndim)
+		throw std::runtime_error("Cursor coordinate index out of range");
+	if (inside[dim] && x == coordinates[dim])
+		return(true);
+	coordinates[dim] = x;
+	inside[dim] = eval.search[dim].hunt(x, centers[dim]);
+	if (!inside[dim])
+		return(false);
+	
+	const detail::knot_search& search = eval.search[dim];
+	float* basis = &localbasis[dim*maxdegree];
+	if (!eval.reciprocals.empty()) {
+		const double* recip = eval.reciprocals[dim].data();
+		if (derivatives & (1 << dim))
+			bspline_deriv_nonzero_reciprocal(search.knots, recip, search.nknots,
+			                                 x, centers[dim], search.order, basis);
+		else
+			bsplvb_simple_reciprocal(search.knots, recip, search.nknots,
+			                         x, centers[dim], search.order + 1, basis);
+	} else if (derivatives & (1 << dim)) {
+		bspline_deriv_nonzero(search.knots,
+							  search.nknots, x, centers[dim],
+							  search.order, basis);
+	} else {
+		bsplvb_simple(search.knots, search.nknots,
+					  x, centers[dim], search.order + 1,
+					  basis);
+	}
+	if (dim + 1 < table.ndim)
+		stale = std::min(stale, dim);
+	return(true);
+}
+
+template<typename Alloc>
+bool splinetable<Alloc>::evaluator::cursor::set_coordinates(const double* x){
+	bool result = true;
+	for (uint32_t n = 0; n < eval.table.ndim; n++)
+		result &= set_coordinate(n, x[n]);
+	return(result);
+}
+
+/*
+ * Recompute the products of the basis functions, and the summed positions
+ * of the coefficients, for the leading dimensions from the first one which
+ * has changed. These are the values which ndsplineeval_core computes in
+ * basis_tree and tablepos for each chunk, formed in the same order.
+ */
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::cursor::update_products(){
+	const splinetable<Alloc>& table = eval.table;
+	for (uint32_t n = stale; n + 1 < table.ndim; n++) {
+		const float* basis = &localbasis[n*maxdegree];
+		const uint32_t width = eval.search[n].order + 1;
+		uint64_t offsets[width];
+		table.coefficient_positions(n, centers[n] - eval.search[n].order, width, offsets);
+		for (size_t c = 0; c < products[n].size(); c++) {
+			for (uint32_t i = 0; i < width; i++) {
+				products[n+1][c*width + i] = products[n][c]*basis[i];
+				positions[n+1][c*width + i] = positions[n][c] + offsets[i];
+			}
+		}
+	}
+	stale = table.ndim - 1;
+}
+
+template<typename Alloc>
+template<typename Coeff>
+double splinetable<Alloc>::evaluator::cursor::accumulate() const{
+	typedef typename detail::coefficient_reader<Coeff>::value_type value_type;
+	const splinetable<Alloc>& table = eval.table;
+	const detail::coefficient_reader<Coeff> coefficient = table.template stored_coefficients<Coeff>();
+	const uint32_t last = table.ndim - 1;
+	const float* basis = &localbasis[last*maxdegree];
+	const uint32_t chunk = eval.search[last].order + 1;
+	uint64_t lastpos[chunk];
+	table.coefficient_positions(last, centers[last] - eval.search[last].order, chunk, lastpos);
+	
+	const std::vector<float>& weights = products[last];
+	const std::vector<uint64_t>& tablepos = positions[last];
+	value_type result = 0;
+	for (size_t c = 0; c < weights.size(); c++) {
+		for (uint32_t i = 0; i < chunk; i++)
+			result+=weights[c]*basis[i]*coefficient(tablepos[c] + lastpos[i]);
+	}
+	return(result);
+}
+
+template<typename Alloc>
+double splinetable<Alloc>::evaluator::cursor::evaluate(){
+	if (std::find(inside.begin(), inside.end(), false) != inside.end())
+		return(0);
+	update_products();
+	switch(eval.table.storage){
+		case coefficient_storage::float16:
+			return(accumulate<detail::half>());
+		case coefficient_storage::bfloat16:
+			return(accumulate<detail::bfloat16>());
+		case coefficient_storage::float64:
+			return(accumulate<double>());
+		case coefficient_storage::int8:
+			return(accumulate<detail::block_quantized<int8_t>>());
+		case coefficient_storage::int16:
+			return(accumulate<detail::block_quantized<int16_t>>());
+		default:
+			return(accumulate<float>());
+	}
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_CURSOR_H
@@ -103,7 +103,7 @@ size_t splinetable<Alloc>::estimateMemory(const std::string& filePath,
 }
 
 template<typename Alloc>
-bool splinetable<Alloc>::read_fits(const std::string& filePath){
+bool splinetable<Alloc>::read_fits(const std::string& filePath, coefficient_storage newStorage){
 	if(ndim!=0)
 		throw std::runtime_error("splinetable already contains data, cannot read from file");
 	
@@ -123,11 +123,11 @@ bool splinetable<Alloc>::read_fits(const std::string& filePath){
 			fits_report_error(stderr, error);
 		}
 	} cleanup(fits);
-	return(read_fits_core(fits, filePath));
+	return(read_fits_core(fits, filePath, newStorage));
 }
 	
 template<typename Alloc>
-bool splinetable<Alloc>::read_fits_mem(void* buffer, size_t buffer_size){
+bool splinetable<Alloc>::read_fits_mem(void* buffer, size_t buffer_size, coefficient_storage newStorage){
 	if(ndim!=0)
 		throw std::runtime_error("splinetable already contains data, cannot read from (memory) file");
 	
@@ -149,12 +149,39 @@ bool splinetable<Alloc>::read_fits_mem(void* buffer, size_t buffer_size){
 			fits_report_error(stderr, error);
 		}
 	} cleanup(fits);
-	return(read_fits_core(fits, "memory 'file'"));
+	return(read_fits_core(fits, "memory 'file'", newStorage));
 }
 	
 template<typename Alloc>
-bool splinetable<Alloc>::read_fits_core(fitsfile* fits, const std::string& filePath){
+template<typename Coeff>
+void splinetable<Alloc>::read_fits_coefficients(fitsfile* fits, int& error){
+	//read in the standard order, a piece at a time, converting as we go
+	uint64_t ncoeffs;
+	coefficient_offsets = make_coefficient_offsets(NULL, ncoeffs);
+	typename allocator_traits::template rebind_traits<Coeff>::pointer data = allocate<Coeff>(ncoeffs);
+	packed_coefficients = (char*)&data[0];
+	storage = (std::is_same<Coeff,double>::value ? coefficient_storage::float64 :
+	           std::is_same<Coeff,detail::half>::value ? coefficient_storage::float16 :
+	           coefficient_storage::bfloat16);
+	
+	const uint64_t chunk=1ULL<<20;
+	std::unique_ptr<double[]> buffer(new double[std::min(chunk,ncoeffs)]);
+	std::vector<long> fpixel(ndim);
+	for (uint64_t first=0; first<ncoeffs && error==0; first+=chunk) {
+		uint64_t n=std::min(chunk,ncoeffs-first);
+		for(uint32_t i=0; i<ndim; i++)
+			fpixel[i] = first/strides[ndim-i-1]%naxes[ndim-i-1]+1;
+		fits_read_pix(fits, TDOUBLE, fpixel.data(), n, NULL, buffer.get(), NULL, &error);
+		for (uint64_t k=0; k<n; k++)
+			detail::store_coefficient(buffer[k], data[first+k]);
+	}
+}
+
+template<typename Alloc>
+bool splinetable<Alloc>::read_fits_core(fitsfile* fits, const std::string& filePath, coefficient_storage newStorage){
 	int error = 0;
+	if (is_quantized(newStorage))
+		throw std::runtime_error("Coefficients cannot be quantized while reading; use quantize_coefficients");
 	//if (error != 0)
 	//	throw std::runtime_error("Failed to move to HDU 1 in "+filePath);
 	
@@ -315,11 +342,17 @@ bool splinetable<Alloc>::read_fits_core(fitsfile* fits, const std::string& fileP
 	std::partial_sum(naxes_temp.begin(),naxes_temp.end()-1,strides+1,std::multiplies<uint64_t>());
 	std::reverse(strides,strides+ndim);
 	uint64_t ncoeffs=strides[0]*naxes[0];
-	coefficients = allocate<float>(ncoeffs);
-	
-	std::vector<long> fpixel(ndim,1);
-	fits_read_pix(fits, TFLOAT, fpixel.data(), ncoeffs, NULL,
-				  &coefficients[0], NULL, &error);
+	switch (newStorage) {
+		case coefficient_storage::float16: read_fits_coefficients<detail::half>(fits, error); break;
+		case coefficient_storage::bfloat16: read_fits_coefficients<detail::bfloat16>(fits, error); break;
+		case coefficient_storage::float64: read_fits_coefficients<double>(fits, error); break;
+		default: {
+			coefficients = allocate<float>(ncoeffs);
+			std::vector<long> fpixel(ndim,1);
+			fits_read_pix(fits, TFLOAT, fpixel.data(), ncoeffs, NULL,
+						  &coefficients[0], NULL, &error);
+		}
+	}
 	
 	if (error != 0){
 		//destroy
@@ -459,13 +492,28 @@ void splinetable<Alloc>::write_fits_core(fitsfile* fits) const{
 			naxes[i] = this->naxes[ndim - i - 1];
 			nelements *= naxes[i];
 		}
-		fits_create_img(fits, FLOAT_IMG, ndim, naxes.get(), &error);
+		fits_create_img(fits, storage==coefficient_storage::float64 ? DOUBLE_IMG : FLOAT_IMG,
+		                ndim, naxes.get(), &error);
 		if (error != 0)
 			throw std::runtime_error("Failed to create FITS image for spline coefficients");
 	
 		std::unique_ptr<long[]> fpixel(new long[ndim]);
 		std::fill_n(fpixel.get(),ndim,1L);
-		fits_write_pix(fits, TFLOAT, fpixel.get(), nelements, &coefficients[0], &error);
+		if (!coefficient_offsets)
+			fits_write_pix(fits, TFLOAT, fpixel.get(), nelements, &coefficients[0], &error);
+		else {
+			//write tiled or converted coefficients in the standard order, a
+			//piece at a time
+			const uint64_t chunk=1ULL<<20;
+			std::unique_ptr<double[]> buffer(new double[std::min(chunk,nelements)]);
+			for (uint64_t first=0; first<nelements && error==0; first+=chunk) {
+				uint64_t n=std::min(chunk,nelements-first);
+				gather_coefficients(first,n,buffer.get());
+				for(uint32_t i=0; i<ndim; i++)
+					fpixel[i] = first/strides[ndim-i-1]%naxes[i]+1;
+				fits_write_pix(fits, TDOUBLE, fpixel.get(), n, buffer.get(), &error);
+			}
+		}
 		if (error != 0)
 			throw std::runtime_error("Failed to write coefficients to FITS image");
 	}
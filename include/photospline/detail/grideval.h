@@ -19,6 +19,7 @@ std::unique_ptr<ndsparse> splinetable<Alloc>::grideval(const DoubleContCont& coo
 		throw(std::logic_error("Number of coordinate vectors ("
 			+std::to_string(coords.size())+
 			") must match dimensions ("+std::to_string(ndim)+")"));
+	require_standard_coefficients("grideval");
 	
 	size_t size = naxes[0]*strides[0];
 	size_t nnz = 0;
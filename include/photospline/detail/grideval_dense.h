@@ -0,0 +1,122 @@
+#ifndef PHOTOSPLINE_DETAIL_GRIDEVAL_DENSE_H
+#define PHOTOSPLINE_DETAIL_GRIDEVAL_DENSE_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+namespace detail{
+
+///The non-zero basis functions of one dimension of a spline at each of a set
+///of coordinates: for the pth coordinate, the weights of width consecutive
+///coefficients starting from first[p]. Coordinates outside the table have
+///all weights zero.
+struct grid_basis{
+	uint32_t width;
+	std::vector<uint64_t> first;
+	std::vector<double> weights;
+};
+
+/*
+ * Contract one dimension of a row-major tensor with a basis: the tensor has
+ * outer*n*inner entries, where n is the extent of the contracted dimension,
+ * and the result has outer*m*inner, where m is the number of coordinates in
+ * the basis. Whole rows of inner entries are combined at once, so the
+ * innermost loop runs over contiguous memory in both tensors.
+ */
+inline void contract_grid_dimension(const double* tensor, uint64_t outer, uint64_t n, uint64_t inner,
+                                    const grid_basis& basis, double* result){
+	const uint64_t m = basis.first.size();
+	for (uint64_t o = 0; o < outer; o++) {
+		const double* slice = tensor + o*n*inner;
+		for (uint64_t p = 0; p < m; p++) {
+			double* row = result + (o*m + p)*inner;
+			const double* weights = &basis.weights[p*basis.width];
+			const double* source = slice + basis.first[p]*inner;
+			std::fill_n(row, inner, 0.);
+			for (uint32_t j = 0; j < basis.width; j++) {
+				const double w = weights[j];
+				if (w == 0)
+					continue;
+				const double* sourceRow = source + j*inner;
+				for (uint64_t k = 0; k < inner; k++)
+					row[k] += w*sourceRow[k];
+			}
+		}
+	}
+}
+
+} //namespace detail
+
+template<typename Alloc>
+template<typename DoubleContCont>
+void splinetable<Alloc>::grideval_dense(const DoubleContCont& coords, double* results, int derivatives) const{
+	typedef typename DoubleContCont::value_type DoubleCont;
+	static_assert(std::is_same<double,typename std::remove_const<typename DoubleCont::value_type>::type>::value,
+	              "DoubleCont must be a container of double values");
+	
+	if (coords.size() != ndim)
+		throw std::runtime_error("Number of coordinate vectors ("
+			+std::to_string(coords.size())+
+			") must match dimensions ("+std::to_string(ndim)+")");
+	
+	std::vector<detail::grid_basis> bases(ndim);
+	std::vector<uint64_t> npoints(ndim);
+	for (uint32_t n = 0; n < ndim; n++) {
+		const DoubleCont& coord_vec = coords[n];
+		detail::grid_basis& basis = bases[n];
+		const detail::knot_search search(&knots[n][0], nknots[n], order[n], naxes[n]);
+		npoints[n] = coord_vec.size();
+		basis.width = order[n] + 1;
+		basis.first.assign(npoints[n], 0);
+		basis.weights.assign(npoints[n]*basis.width, 0.);
+		float localbasis[basis.width];
+		uint64_t p = 0;
+		for (double x : coord_vec) {
+			int center;
+			if (search.find(x, center)) {
+				if (derivatives & (1 << n))
+					bspline_deriv_nonzero(&knots[n][0], nknots[n], x, center, order[n], localbasis);
+				else
+					bsplvb_simple(&knots[n][0], nknots[n], x, center, order[n] + 1, localbasis);
+				basis.first[p] = center - order[n];
+				std::copy_n(localbasis, basis.width, &basis.weights[p*basis.width]);
+			}
+			p++;
+		}
+		if (npoints[n] == 0)
+			return;
+	}
+	
+	/*
+	 * Contract the coefficients with the bases one dimension at a time,
+	 * first in the dimensions which shrink the tensor the most (or grow it
+	 * the least), so that the intermediate tensors stay small.
+	 */
+	std::vector<uint32_t> sequence(ndim);
+	std::iota(sequence.begin(), sequence.end(), 0);
+	std::stable_sort(sequence.begin(), sequence.end(), [&](uint32_t a, uint32_t b){
+		return(double(npoints[a])/naxes[a] < double(npoints[b])/naxes[b]);
+	});
+	
+	std::vector<uint64_t> extents(&naxes[0], &naxes[0] + ndim);
+	std::vector<double> tensor(get_ncoeffs()), contracted;
+	gather_coefficients(0, tensor.size(), tensor.data());
+	for (uint32_t s = 0; s < ndim; s++) {
+		const uint32_t n = sequence[s];
+		const uint64_t outer = std::accumulate(extents.begin(), extents.begin() + n, 1ULL, std::multiplies<uint64_t>());
+		const uint64_t inner = std::accumulate(extents.begin() + n + 1, extents.end(), 1ULL, std::multiplies<uint64_t>());
+		double* out = results;
+		if (s + 1 < ndim) {
+			contracted.resize(outer*npoints[n]*inner);
+			out = contracted.data();
+		}
+		detail::contract_grid_dimension(tensor.data(), outer, extents[n], inner, bases[n], out);
+		extents[n] = npoints[n];
+		tensor.swap(contracted);
+	}
+}
+
+} //namespace photospline
+
+#endif // PHOTOSPLINE_DETAIL_GRIDEVAL_DENSE_H
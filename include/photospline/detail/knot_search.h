@@ -0,0 +1,257 @@
+#ifndef PHOTOSPLINE_KNOT_SEARCH_H
+#define PHOTOSPLINE_KNOT_SEARCH_H
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace photospline{
+namespace detail{
+
+///Find the last of n knots, starting from first, which is not greater
+///than x, or the first if none is. The search is done without branches which
+///depend on x, since those would be mispredicted half of the time.
+inline int bisect_knots(const double* knots, int first, uint32_t n, double x){
+	int c = first;
+	for (uint32_t len = n; len > 1; ) {
+		uint32_t half = len/2;
+		c += (knots[c+half] <= x) ? half : 0;
+		len -= half;
+	}
+	return(c);
+}
+
+///Find the center for a coordinate in one dimension of a spline, as
+///splinetable::searchcenters does, by bisecting the fully-supported knots
+inline int bisect_center(const double* knots, uint32_t order, uint64_t naxes, double x){
+	if (naxes <= order)
+		return(x < knots[order] ? order : naxes - 1);
+	return(bisect_knots(knots, order, naxes - order, x));
+}
+
+///Check whether a guess, or one of its neighbors, is the center for a
+///coordinate in one dimension of a spline. When successive coordinates are
+///close together, as along a track, this is usually the case, and checking
+///is much cheaper than searching.
+///\param guess a previously found center, which need not be valid
+///\return the center, or -1 if it is not near the guess
+inline int near_center(const double* knots, uint32_t order, uint64_t naxes, double x, int guess){
+	const int first = order;
+	const int last = (int)naxes - 1;
+	//c is the center if x is between its knot and the next, except that the
+	//first and last centers also cover coordinates beyond them
+	auto is_center=[=](int c){
+		return((c == first || knots[c] <= x) && (c == last || x < knots[c+1]));
+	};
+	if (guess < first || guess > last)
+		return(-1);
+	if (is_center(guess))
+		return(guess);
+	if (guess < last && is_center(guess + 1))
+		return(guess + 1);
+	if (guess > first && is_center(guess - 1))
+		return(guess - 1);
+	return(-1);
+}
+
+///Locates the center knot for coordinates in one dimension of a spline.
+///
+///For modest numbers of knots, bisection without branches is fastest, since
+///the knots stay in cache. For larger numbers, when the knots are evenly
+///spaced the center is computed directly from the coordinate. Otherwise, the
+///range of the fully-supported knots is divided into equal buckets, and a
+///table records which knots can be the center for coordinates in each
+///bucket, so that only those need to be searched. In all cases the result is
+///exactly that of splinetable::searchcenters.
+struct knot_search{
+	///the minimum number of knot intervals for which the center is computed
+	///directly for uniformly spaced knots; below this bisection is as fast.
+	///For 2^20 random coordinates in order 2 knots, the direct method takes
+	///1.9, 1.1, 0.76, 0.55 and 0.26 of the time of bisection for 8, 16, 32,
+	///64 and 1024 intervals.
+	static constexpr uint64_t min_direct_intervals = 32;
+	///the minimum number of knot intervals for which a table is used for
+	///non-uniform knots; below this the knots fit in cache, and bisecting
+	///them is as fast
+	static constexpr uint64_t min_table_intervals = 8192;
+	///the maximum number of buckets per knot interval in the table, which
+	///bounds its memory use
+	static constexpr uint64_t max_buckets_per_interval = 4;
+	
+	enum class method{
+		bisection, ///< bisect all of the fully-supported knots
+		direct, ///< compute the center from the coordinate
+		table ///< bisect the knots listed for the coordinate's bucket
+	};
+	
+	const double* knots;
+	uint64_t nknots;
+	uint32_t order;
+	uint64_t naxes;
+	///the way in which centers are found
+	method lookup;
+	///whether the fully-supported knots are uniformly spaced
+	bool is_uniform;
+	///the first fully-supported knot
+	double origin;
+	///the number of buckets per unit coordinate
+	double scale;
+	///the number of buckets, which are knot intervals for the direct method
+	uint64_t nbuckets;
+	///for each bucket, the first knot which may be the center for
+	///coordinates in it, followed by the last knot which may be the center
+	///for coordinates in the last bucket
+	std::vector<uint32_t> bucket_centers;
+	///the number of bisection steps needed to search the knots which may be
+	///the center for coordinates in any bucket of the table
+	uint32_t search_steps;
+	
+	knot_search(const double* knots, uint64_t nknots, uint32_t order, uint64_t naxes):
+	knots(knots),nknots(nknots),order(order),naxes(naxes),
+	lookup(method::bisection),is_uniform(false),
+	origin(knots[order]),scale(0),nbuckets(0),search_steps(0){
+		if (naxes <= order)
+			return;
+		uint64_t nintervals = naxes - order;
+		double range = knots[naxes] - origin;
+		if (!(range > 0) || !std::isfinite(range))
+			return;
+		
+		double spacing = range/nintervals;
+		double min_interval = range;
+		is_uniform = true;
+		for (uint64_t i = 0; i < nintervals; i++) {
+			//allow small deviations, such as from rounding when the knots
+			//were generated, but none large enough that the computed center
+			//could be more than one knot away from the true one
+			if (std::abs(knots[order+i] - (origin + i*spacing)) > 1e-2*spacing)
+				is_uniform = false;
+			double interval = knots[order+i+1] - knots[order+i];
+			if (interval > 0)
+				min_interval = std::min(min_interval, interval);
+		}
+		if (is_uniform) {
+			if (nintervals >= min_direct_intervals) {
+				lookup = method::direct;
+				nbuckets = nintervals;
+				scale = 1/spacing;
+			}
+			return;
+		}
+		if (nintervals < min_table_intervals)
+			return;
+		
+		//use enough buckets that each contains at most two knots, if the
+		//memory bound permits
+		double ideal_buckets = std::ceil(range/min_interval);
+		nbuckets = nintervals*max_buckets_per_interval;
+		if (ideal_buckets < nbuckets)
+			nbuckets = std::max<uint64_t>(ideal_buckets, nintervals);
+		scale = nbuckets/range;
+		/*
+		 * Since bucket() never decreases as its argument increases, every
+		 * knot in an earlier bucket than a coordinate is below it, and every
+		 * knot in a later bucket is above it. So the center for coordinates
+		 * in a bucket is between the last knot in an earlier bucket and the
+		 * last knot in the same bucket, regardless of rounding.
+		 */
+		std::vector<uint32_t> centers(nbuckets+1);
+		uint32_t max_span = 0;
+		uint32_t c = order;
+		for (uint64_t b = 0; b <= nbuckets; b++) {
+			while (c < naxes - 1 && bucket(knots[c+1]) < (int64_t)b)
+				c++;
+			centers[b] = c;
+			if (b > 0)
+				max_span = std::max(max_span, c - centers[b-1]);
+		}
+		//the table is only worthwhile if it saves at least a couple of steps
+		uint32_t steps = bisection_steps(max_span + 1);
+		if (steps + 2 <= bisection_steps(nintervals)) {
+			lookup = method::table;
+			bucket_centers.swap(centers);
+			search_steps = steps;
+		}
+	}
+	
+	///The number of times a range of n elements must be halved, rounding
+	///the larger half up, to reach one element
+	static uint32_t bisection_steps(uint64_t n){
+		uint32_t steps = 0;
+		for (; n > 1; n -= n/2)
+			steps++;
+		return(steps);
+	}
+	
+	///Get the bucket containing a coordinate, clamped to the valid buckets
+	int64_t bucket(double x) const{
+		double t = (x - origin)*scale;
+		t = (t >= 0) ? std::min(t, double(nbuckets - 1)) : 0;
+		return((int64_t)t);
+	}
+	
+	///Find the center for a coordinate with the direct method.
+	///Since the knots deviate from an even grid by much less than half of
+	///their spacing, the computed index is at most one away from the
+	///center, so a single step in each direction corrects it. There are no
+	///branches which depend on x, so this can be done for several
+	///coordinates at once.
+	///\pre lookup == method::direct
+	int direct_center(double x) const{
+		int c = order + bucket(x);
+		c -= (c > (int)order && x < knots[c]);
+		c += (c < (int)naxes - 1 && x >= knots[c+1]);
+		return(c);
+	}
+	
+	///Find the center for a coordinate, as splinetable::searchcenters does
+	///for a single dimension, without checking that the coordinate is
+	///within the table.
+	int center(double x) const{
+		switch (lookup) {
+			case method::direct:
+				return(direct_center(x));
+			case method::table:
+				break;
+			default:
+				return(bisect_center(knots, order, naxes, x));
+		}
+		
+		//search only the knots which may be the center for coordinates in
+		//this bucket, treating probes past the last of them as probing it
+		int64_t b = bucket(x);
+		int c = bucket_centers[b];
+		const int last = bucket_centers[b + 1];
+		for (uint32_t len = (1u << search_steps); len > 1; ) {
+			len /= 2;
+			int probe = std::min<int>(c + len, last);
+			c = (knots[probe] <= x) ? probe : c;
+		}
+		return(c);
+	}
+	
+	///Find the center for a coordinate, starting from a guess
+	///\return false if the coordinate is outside the table
+	bool hunt(double x, int& c) const{
+		if (x <= knots[0] || x > knots[nknots-1])
+			return(false);
+		int near = near_center(knots, order, naxes, x, c);
+		c = (near >= 0) ? near : center(x);
+		return(true);
+	}
+	
+	///Find the center for a coordinate
+	///\return false if the coordinate is outside the table
+	bool find(double x, int& c) const{
+		if (x <= knots[0] || x > knots[nknots-1])
+			return(false);
+		c = center(x);
+		return(true);
+	}
+};
+
+} //namespace detail
+} //namespace photospline
+
+#endif //PHOTOSPLINE_KNOT_SEARCH_H
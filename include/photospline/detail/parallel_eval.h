@@ -0,0 +1,80 @@
+#ifndef PHOTOSPLINE_PARALLEL_EVAL_H
+#define PHOTOSPLINE_PARALLEL_EVAL_H
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::ndsplineeval_parallel(const double* const* coordinates, size_t npoints,
+                                                          double* results, int derivatives,
+                                                          unsigned int nthreads) const
+{
+	//small enough that a thread which draws a chunk of expensive points
+	//does not hold up the others for long, but large enough that claiming
+	//chunks is cheap compared to evaluating them
+	const size_t chunk = 64*PHOTOSPLINE_VECTOR_SIZE;
+	const size_t nchunks = (npoints + chunk - 1)/chunk;
+	if (nthreads == 0)
+		nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+	nthreads = std::min<size_t>(nthreads, nchunks);
+	if (nthreads <= 1) {
+		ndsplineeval_batch(coordinates, npoints, results, derivatives);
+		return;
+	}
+	
+	/*
+	 * Each worker repeatedly claims the next unevaluated chunk of points,
+	 * so threads which draw cheap chunks (such as ones mostly outside the
+	 * table) go on to take more, and all finish at nearly the same time.
+	 * Since each point is written only to its own slot of results, and
+	 * evaluated exactly as ndsplineeval_batch would, the output does not
+	 * depend on how the chunks were shared out.
+	 */
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::mutex errorLock;
+	auto work=[&](){
+		try {
+			std::vector<const double*> chunkCoordinates(table.ndim);
+			for (size_t c = next++; c < nchunks; c = next++) {
+				const size_t start = c*chunk;
+				for (uint32_t n = 0; n < table.ndim; n++)
+					chunkCoordinates[n] = coordinates[n] + start;
+				ndsplineeval_batch(chunkCoordinates.data(), std::min(chunk, npoints - start),
+				                   results + start, derivatives);
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(errorLock);
+			if (!error)
+				error = std::current_exception();
+			//stop the other workers from starting new chunks
+			next = nchunks;
+		}
+	};
+	
+	std::vector<std::thread> workers;
+	workers.reserve(nthreads - 1);
+	try {
+		for (unsigned int t = 1; t < nthreads; t++)
+			workers.emplace_back(work);
+	} catch (std::system_error&) {
+		//if no more threads can be started, those which have been (and this
+		//one) take the whole workload between them
+	}
+	work();
+	for (std::thread& worker : workers)
+		worker.join();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_PARALLEL_EVAL_H
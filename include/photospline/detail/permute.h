@@ -24,6 +24,7 @@ void splinetable<Alloc>::permuteDimensions(const std::vector<size_t>& permutatio
 				throw std::runtime_error("Missing index in permutation passed to permuteDimensions");
 		}
 	}
+	require_standard_coefficients("permuteDimensions");
 	
 	//Note that we use regular pointers because these allocations will be 'local'
 	//to this function.
@@ -0,0 +1,153 @@
+#ifndef PHOTOSPLINE_PIPELINED_EVAL_H
+#define PHOTOSPLINE_PIPELINED_EVAL_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+template<typename Alloc>
+void splinetable<Alloc>::prefetch_support(const int* centers) const{
+	switch (storage) {
+		case coefficient_storage::float16: prefetch_support<detail::half>(centers); break;
+		case coefficient_storage::bfloat16: prefetch_support<detail::bfloat16>(centers); break;
+		case coefficient_storage::float64: prefetch_support<double>(centers); break;
+		case coefficient_storage::int8: prefetch_support<detail::block_quantized<int8_t>>(centers); break;
+		case coefficient_storage::int16: prefetch_support<detail::block_quantized<int16_t>>(centers); break;
+		default: prefetch_support<float>(centers);
+	}
+}
+
+/*
+ * The supported coefficients form rows of order+1 along the last dimension,
+ * which are contiguous (or, when tiled, split across at most two tiles), so
+ * fetching the first and last coefficient of each row brings in all of them.
+ */
+template<typename Alloc>
+template<typename Coeff>
+void splinetable<Alloc>::prefetch_support(const int* centers) const{
+	const detail::coefficient_reader<Coeff> coefficient = stored_coefficients<Coeff>();
+	const uint32_t* order = &this->order[0];
+	const uint32_t last = ndim - 1;
+	const uint64_t rowStart = coefficient_position(last, centers[last] - order[last]);
+	const uint64_t rowEnd = coefficient_position(last, centers[last]);
+	uint32_t index[ndim];
+	std::fill_n(index, ndim, 0);
+	while (true) {
+		uint64_t pos = 0;
+		for (uint32_t n = 0; n < last; n++)
+			pos += coefficient_position(n, centers[n] - order[n] + index[n]);
+		__builtin_prefetch(coefficient.address(pos + rowStart));
+		__builtin_prefetch(coefficient.address(pos + rowEnd));
+		
+		//advance to the next row, carrying to earlier dimensions
+		uint32_t n = last;
+		while (n > 0 && ++index[n-1] > order[n-1])
+			index[--n] = 0;
+		if (n == 0)
+			break;
+	}
+}
+
+namespace detail{
+
+///Interleave the bits of a point's centers, so that sorting by the result
+///puts points in nearby cells close together (the Morton or Z order)
+inline uint64_t morton_key(const int* centers, uint32_t ndim){
+	//centers have at most 32 bits, however few dimensions there are
+	const uint32_t bits = std::min(64/ndim, 32u);
+	uint64_t key = 0;
+	for (uint32_t b = 0; b < bits; b++) {
+		for (uint32_t n = 0; n < ndim; n++)
+			key |= uint64_t((uint32_t(centers[n]) >> b) & 1) << (b*ndim + n);
+	}
+	return(key);
+}
+
+} //namespace detail
+
+template<typename Alloc>
+void splinetable<Alloc>::evaluator::ndsplineeval_pipelined(const double* const* coordinates, size_t npoints,
+                                                           double* results, int derivatives, bool reorder) const
+{
+	const uint32_t ndim = table.ndim;
+	//the number of points whose coefficients are requested ahead of their
+	//evaluation: enough to cover the latency of main memory, but few
+	//enough that their requests do not overflow the processor's queue of
+	//outstanding cache misses and evict each other
+	const uint32_t W = 8;
+	
+	/*
+	 * When reordering, the centers of all points are needed up front to
+	 * sort them, so they are kept for the evaluation. The sequence holds
+	 * the indices of the points in the order in which they are evaluated;
+	 * each result is written back to its point's own slot.
+	 */
+	std::vector<size_t> sequence;
+	std::vector<int> allCenters;
+	std::vector<bool> allInside;
+	std::vector<double> x(ndim);
+	if (reorder) {
+		allCenters.resize(npoints*ndim);
+		allInside.resize(npoints);
+		std::vector<std::pair<uint64_t,size_t>> keys(npoints);
+		for (size_t p = 0; p < npoints; p++) {
+			for (uint32_t n = 0; n < ndim; n++)
+				x[n] = coordinates[n][p];
+			allInside[p] = searchcenters(x.data(), &allCenters[p*ndim]);
+			//points outside the table need no coefficients, so go last
+			keys[p].first = allInside[p] ? detail::morton_key(&allCenters[p*ndim], ndim) : UINT64_MAX;
+			keys[p].second = p;
+		}
+		std::sort(keys.begin(), keys.end());
+		sequence.resize(npoints);
+		for (size_t i = 0; i < npoints; i++)
+			sequence[i] = keys[i].second;
+	}
+	
+	//two windows of points, one whose coefficients are being fetched, and
+	//one which is being evaluated, with the entries for the kth point of
+	//each at index slot*W + k
+	std::vector<int> centers(2*W*ndim);
+	std::vector<float> localbasis_store(2*W*ndim*maxdegree);
+	bool inside[2*W];
+	
+	auto prepare=[&](size_t first, uint32_t slot){
+		for (uint32_t k = slot*W; k < (slot+1)*W && first < npoints; k++, first++) {
+			const size_t p = reorder ? sequence[first] : first;
+			int* pointCenters = &centers[k*ndim];
+			for (uint32_t n = 0; n < ndim; n++)
+				x[n] = coordinates[n][p];
+			if (reorder) {
+				inside[k] = allInside[p];
+				std::copy_n(&allCenters[p*ndim], ndim, pointCenters);
+			} else
+				inside[k] = searchcenters(x.data(), pointCenters);
+			if (!inside[k])
+				continue;
+			fill_basis(x.data(), pointCenters, derivatives,
+			           detail::buffer2d<float>{&localbasis_store[k*ndim*maxdegree],maxdegree});
+			table.prefetch_support(pointCenters);
+		}
+	};
+	
+	prepare(0, 0);
+	for (size_t first = 0; first < npoints; first += W) {
+		const uint32_t slot = (first/W) & 1;
+		if (first + W < npoints)
+			prepare(first + W, slot ^ 1);
+		for (uint32_t i = 0; i < W && first + i < npoints; i++) {
+			const size_t p = reorder ? sequence[first + i] : first + i;
+			const uint32_t k = slot*W + i;
+			if (!inside[k]) {
+				results[p] = 0;
+				continue;
+			}
+			detail::buffer2d<float> localbasis{&localbasis_store[k*ndim*maxdegree],maxdegree};
+			results[p] = (table.*(eval_ptr))(&centers[k*ndim], maxdegree, localbasis);
+		}
+	}
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_PIPELINED_EVAL_H
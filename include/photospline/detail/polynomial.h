@@ -0,0 +1,247 @@
+#ifndef PHOTOSPLINE_POLYNOMIAL_H
+#define PHOTOSPLINE_POLYNOMIAL_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+namespace detail{
+
+/*
+ * Find the coefficients, in powers of u = (x - knots[j])/(knots[j+1] - knots[j]),
+ * of the order+1 B-splines which are non-zero in the jth knot interval,
+ * B[i](x) = sum_k result[i*(order+1) + k]*u^k. Each B-spline is a single
+ * polynomial over the interval, so it is fixed by its values at order+1
+ * points inside the interval; these are found by solving for the polynomial
+ * through them. B-splines which have no coefficient (off either end of the
+ * table) are left as zero.
+ */
+inline void interval_polynomials(const double* knots, uint32_t order, uint64_t naxes,
+                                 uint64_t j, double* result){
+	const uint32_t w = order + 1;
+	std::fill_n(result, w*w, 0.);
+	const double width = knots[j+1] - knots[j];
+	if (!(width > 0))
+		return;
+	//the system of equations for each B-spline, with the values of the
+	//powers of u at the sample points in the first w columns of each row
+	//and the values of the B-splines at them in the rest
+	std::vector<double> system(w*2*w);
+	for (uint32_t s = 0; s < w; s++) {
+		double* row = &system[s*2*w];
+		const double u = (s + 0.5)/w;
+		row[0] = 1;
+		for (uint32_t k = 1; k < w; k++)
+			row[k] = row[k-1]*u;
+		for (uint32_t i = 0; i < w; i++) {
+			const int64_t g = int64_t(j) - order + i;
+			row[w+i] = (g >= 0 && g < (int64_t)naxes) ? bspline(knots, knots[j] + u*width, g, order) : 0;
+		}
+	}
+	//Gauss-Jordan elimination with partial pivoting
+	for (uint32_t c = 0; c < w; c++) {
+		uint32_t pivot = c;
+		for (uint32_t r = c + 1; r < w; r++) {
+			if (std::abs(system[r*2*w+c]) > std::abs(system[pivot*2*w+c]))
+				pivot = r;
+		}
+		if (pivot != c)
+			std::swap_ranges(&system[c*2*w], &system[c*2*w] + 2*w, &system[pivot*2*w]);
+		const double scale = 1/system[c*2*w+c];
+		for (uint32_t k = c; k < 2*w; k++)
+			system[c*2*w+k] *= scale;
+		for (uint32_t r = 0; r < w; r++) {
+			if (r == c)
+				continue;
+			const double factor = system[r*2*w+c];
+			for (uint32_t k = c; k < 2*w; k++)
+				system[r*2*w+k] -= factor*system[c*2*w+k];
+		}
+	}
+	for (uint32_t k = 0; k < w; k++) {
+		for (uint32_t i = 0; i < w; i++)
+			result[i*w + k] = system[k*2*w + w + i];
+	}
+}
+
+///Evaluate the polynomial sum_k p[k]*u^k of the given degree, or its
+///derivative with respect to x = origin + u/scale
+inline double horner(const double* p, uint32_t degree, double u, bool derivative, double scale){
+	if (!derivative) {
+		double r = p[degree];
+		for (uint32_t k = degree; k-- > 0; )
+			r = r*u + p[k];
+		return(r);
+	}
+	if (degree == 0)
+		return(0);
+	double r = degree*p[degree];
+	for (uint32_t k = degree - 1; k > 0; k--)
+		r = r*u + k*p[k];
+	return(r*scale);
+}
+
+} //namespace detail
+
+template<typename Alloc>
+splinetable<Alloc>::polynomial_evaluator::polynomial_evaluator(const splinetable<Alloc>& table):
+table(table),ndim(table.ndim),order(&table.order[0], &table.order[0] + table.ndim),
+knots(table.ndim),scales(table.ndim),ncells(table.ndim),cellsize(1){
+	std::vector<std::vector<double>> intervals(ndim);
+	uint64_t totalCells = 1;
+	for (uint32_t n = 0; n < ndim; n++) {
+		const uint32_t w = order[n] + 1;
+		knots[n].assign(&table.knots[n][0], &table.knots[n][0] + table.nknots[n]);
+		ncells[n] = table.nknots[n] - 1;
+		scales[n].resize(ncells[n]);
+		intervals[n].resize(ncells[n]*w*w);
+		for (uint64_t j = 0; j < ncells[n]; j++) {
+			const double width = knots[n][j+1] - knots[n][j];
+			scales[n][j] = (width > 0 ? 1/width : 0);
+			detail::interval_polynomials(knots[n].data(), order[n], table.naxes[n], j, &intervals[n][j*w*w]);
+		}
+		cellsize *= w;
+		totalCells *= ncells[n];
+	}
+	
+	std::vector<double> tableCoefficients(table.get_ncoeffs());
+	table.gather_coefficients(0, tableCoefficients.size(), tableCoefficients.data());
+	coefficients.resize(totalCells*cellsize);
+	
+	/*
+	 * For each cell, gather the coefficients of the B-splines which are
+	 * non-zero in it, and transform them one dimension at a time from
+	 * weights of the B-splines to weights of the powers of u.
+	 */
+	std::vector<uint64_t> cell(ndim, 0);
+	std::vector<double> block(cellsize), transformed(cellsize);
+	for (uint64_t c = 0; c < totalCells; c++) {
+		for (uint64_t e = 0; e < cellsize; e++) {
+			uint64_t rest = e, pos = 0;
+			bool supported = true;
+			for (uint32_t n = ndim; n-- > 0; ) {
+				const uint32_t w = order[n] + 1;
+				const int64_t g = int64_t(cell[n]) - order[n] + rest%w;
+				rest /= w;
+				supported &= (g >= 0 && g < (int64_t)table.naxes[n]);
+				pos += g*table.strides[n];
+			}
+			block[e] = supported ? tableCoefficients[pos] : 0;
+		}
+		uint64_t inner = cellsize;
+		for (uint32_t n = 0; n < ndim; n++) {
+			const uint32_t w = order[n] + 1;
+			const double* matrix = &intervals[n][cell[n]*w*w];
+			inner /= w;
+			const uint64_t outer = cellsize/(w*inner);
+			std::fill(transformed.begin(), transformed.end(), 0.);
+			for (uint64_t o = 0; o < outer; o++) {
+				for (uint32_t i = 0; i < w; i++) {
+					const double* source = &block[(o*w + i)*inner];
+					for (uint32_t k = 0; k < w; k++) {
+						double* dest = &transformed[(o*w + k)*inner];
+						for (uint64_t r = 0; r < inner; r++)
+							dest[r] += matrix[i*w + k]*source[r];
+					}
+				}
+			}
+			block.swap(transformed);
+		}
+		std::copy(block.begin(), block.end(), &coefficients[c*cellsize]);
+		
+		for (uint32_t n = ndim; n-- > 0; ) {
+			if (++cell[n] < ncells[n])
+				break;
+			cell[n] = 0;
+		}
+	}
+}
+
+template<typename Alloc>
+bool splinetable<Alloc>::polynomial_evaluator::searchcells(const double* x, int* cells) const{
+	for (uint32_t n = 0; n < ndim; n++) {
+		const std::vector<double>& k = knots[n];
+		if (x[n] <= k.front() || x[n] > k.back())
+			return(false);
+		//the last knot not greater than x, or the start of the last cell
+		//for x on the last knot
+		cells[n] = detail::bisect_knots(k.data(), 0, ncells[n], x[n]);
+	}
+	return(true);
+}
+
+template<typename Alloc>
+double splinetable<Alloc>::polynomial_evaluator::ndsplineeval(const double* x, const int* cells, int derivatives) const{
+	uint64_t cell = 0;
+	double u[ndim];
+	for (uint32_t n = 0; n < ndim; n++) {
+		cell = cell*ncells[n] + cells[n];
+		u[n] = (x[n] - knots[n][cells[n]])*scales[n][cells[n]];
+	}
+	
+	//nested Horner scheme: each pass replaces the polynomials in the last
+	//remaining dimension by their values, in place after the first pass,
+	//since each value is written no later than the first coefficient of
+	//its polynomial is read
+	const double* in = &coefficients[cell*cellsize];
+	double work[cellsize/(order[ndim-1] + 1)];
+	uint64_t size = cellsize;
+	for (uint32_t n = ndim; n-- > 0; ) {
+		const uint32_t w = order[n] + 1;
+		const bool derivative = derivatives & (1 << n);
+		size /= w;
+		for (uint64_t r = 0; r < size; r++)
+			work[r] = detail::horner(in + r*w, order[n], u[n], derivative, scales[n][cells[n]]);
+		in = work;
+	}
+	return(work[0]);
+}
+
+template<typename Alloc>
+double splinetable<Alloc>::polynomial_evaluator::operator()(const double* x, int derivatives) const{
+	int cells[ndim];
+	if (!searchcells(x, cells))
+		return(0);
+	return(ndsplineeval(x, cells, derivatives));
+}
+
+template<typename Alloc>
+typename splinetable<Alloc>::polynomial_evaluator::tradeoff
+splinetable<Alloc>::polynomial_evaluator::compare(size_t trialCount) const{
+	tradeoff result;
+	result.table_bytes = table.stored_ncoeffs()*coefficient_storage_size(table.storage);
+	result.polynomial_bytes = memory_usage();
+	
+	std::default_random_engine rng(52);
+	std::vector<std::uniform_real_distribution<>> dists;
+	for (uint32_t n = 0; n < ndim; n++)
+		dists.push_back(std::uniform_real_distribution<>(table.lower_extent(n), table.upper_extent(n)));
+	std::vector<double> points(trialCount*ndim);
+	for (size_t i = 0; i < trialCount; i++) {
+		for (uint32_t n = 0; n < ndim; n++)
+			points[i*ndim + n] = dists[n](rng);
+	}
+	
+	const evaluator eval = table.get_evaluator();
+	volatile double dummy;
+	std::chrono::high_resolution_clock::time_point t1, t2;
+	t1 = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < trialCount; i++)
+		dummy = eval(&points[i*ndim]);
+	t2 = std::chrono::high_resolution_clock::now();
+	result.table_eval_rate = trialCount/
+	  std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+	
+	t1 = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < trialCount; i++)
+		dummy = (*this)(&points[i*ndim]);
+	t2 = std::chrono::high_resolution_clock::now();
+	result.polynomial_eval_rate = trialCount/
+	  std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+	(void)dummy;
+	return(result);
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_POLYNOMIAL_H
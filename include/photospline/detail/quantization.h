@@ -0,0 +1,136 @@
+#ifndef PHOTOSPLINE_QUANTIZATION_H
+#define PHOTOSPLINE_QUANTIZATION_H
+
+#include <functional>
+#include <limits>
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+template<typename Alloc>
+double splinetable<Alloc>::quantize_coefficients(coefficient_storage newStorage, uint32_t tileSize){
+	if (!is_quantized(newStorage))
+		throw std::runtime_error("Coefficients can only be quantized to int8 or int16");
+	if (is_quantized(storage))
+		throw std::runtime_error("Coefficients are already quantized");
+	if (tileSize == 0)
+		throw std::runtime_error("Coefficient tiles must have a positive size");
+	std::unique_ptr<uint32_t[]> tileExtents(new uint32_t[ndim]);
+	for (uint32_t i = 0; i < ndim; i++)
+		tileExtents[i] = detail::choose_tile_extent(naxes[i], tileSize);
+	if (newStorage == coefficient_storage::int8)
+		return(quantize_coefficients<int8_t>(tileExtents.get()));
+	return(quantize_coefficients<int16_t>(tileExtents.get()));
+}
+
+template<typename Alloc>
+template<typename Int>
+double splinetable<Alloc>::quantize_coefficients(const uint32_t* tileExtents){
+	uint64_t nstored;
+	uint64_t_ptr_ptr newOffsets = make_coefficient_offsets(tileExtents, nstored);
+	struct offsets_cleanup{
+		splinetable& table;
+		uint64_t_ptr_ptr offsets;
+		~offsets_cleanup(){
+			if (offsets) {
+				table.deallocate(offsets[0], std::accumulate(table.naxes, table.naxes+table.ndim, 0ULL));
+				table.deallocate(offsets, table.ndim);
+			}
+		}
+	} cleanup{*this, newOffsets};
+	
+	const uint64_t tileSize = std::accumulate(tileExtents, tileExtents+ndim, 1ULL, std::multiplies<uint64_t>());
+	const uint64_t nblocks = nstored/tileSize;
+	//the position in storage must fit in the lowest bits of the offsets,
+	//and the index of the tile in the rest
+	uint32_t shift = 0;
+	while ((nstored - 1) >> shift)
+		shift++;
+	if (shift > 0 && (nblocks - 1) >> (64 - shift))
+		throw std::runtime_error("Too many tiles to quantize; use larger tiles");
+	
+	//visit the coefficients in the standard order, finding the position of
+	//each in the new layout, and thus its tile
+	const uint64_t ncoeffs = get_ncoeffs(), chunk = 1ULL<<16;
+	std::unique_ptr<double[]> buffer(new double[chunk]);
+	std::unique_ptr<uint64_t[]> index(new uint64_t[ndim]);
+	auto visit=[&](std::function<void(double,uint64_t)> action){
+		std::fill_n(index.get(), ndim, 0);
+		for (uint64_t first = 0; first < ncoeffs; first += chunk) {
+			uint64_t n = std::min(chunk, ncoeffs - first);
+			gather_coefficients(first, n, buffer.get());
+			for (uint64_t k = 0; k < n; k++) {
+				uint64_t pos = 0;
+				for (uint32_t i = 0; i < ndim; i++)
+					pos += newOffsets[i][index[i]];
+				action(buffer[k], pos);
+				for (uint32_t i = ndim; i-- > 0; ) {
+					if (++index[i] < naxes[i])
+						break;
+					index[i] = 0;
+				}
+			}
+		}
+	};
+	
+	//find the range of each tile
+	std::vector<float> minima(nblocks, std::numeric_limits<float>::infinity());
+	std::vector<float> maxima(nblocks, -std::numeric_limits<float>::infinity());
+	visit([&](double c, uint64_t pos){
+		if (!std::isfinite(c))
+			throw std::runtime_error("Non-finite coefficients cannot be quantized");
+		uint64_t block = pos/tileSize;
+		minima[block] = std::min(minima[block], float(c));
+		maxima[block] = std::max(maxima[block], float(c));
+	});
+	
+	//map the range of each tile onto the full range of the integers
+	const double lowest = std::numeric_limits<Int>::min();
+	const double levels = double(std::numeric_limits<Int>::max()) - lowest;
+	float_ptr parameters = allocate<float>(2*nblocks);
+	for (uint64_t b = 0; b < nblocks; b++) {
+		float scale = (double(maxima[b]) - minima[b])/levels;
+		parameters[2*b] = scale;
+		parameters[2*b+1] = minima[b] - lowest*scale;
+	}
+	
+	typename allocator_traits::template rebind_traits<Int>::pointer newCoefficients = allocate<Int>(nstored);
+	Int* data = &newCoefficients[0];
+	//partial tiles are padded with zeros
+	if (nstored != ncoeffs)
+		std::fill_n(data, nstored, Int(0));
+	double maxError = 0;
+	visit([&](double c, uint64_t pos){
+		const float* block = &parameters[2*(pos/tileSize)];
+		double q = (block[0] > 0 ? std::round((c - block[1])/block[0]) : 0);
+		data[pos] = Int(std::max(lowest, std::min(lowest + levels, q)));
+		//decode exactly as evaluation will
+		float decoded = block[0]*data[pos] + block[1];
+		maxError = std::max(maxError, std::abs(decoded - c));
+	});
+	
+	//record the tile of each coefficient in its offsets
+	uint64_t blockStride = 1;
+	for (uint32_t i = ndim; i-- > 0; ) {
+		for (uint64_t j = 0; j < naxes[i]; j++)
+			newOffsets[i][j] += (j/tileExtents[i]*blockStride) << shift;
+		blockStride *= (naxes[i] + tileExtents[i] - 1)/tileExtents[i];
+	}
+	uint32_t_ptr newExtents = allocate<uint32_t>(ndim);
+	std::copy_n(tileExtents, ndim, newExtents);
+	
+	release_coefficients();
+	packed_coefficients = (char*)data;
+	block_parameters = parameters;
+	block_shift = shift;
+	storage = (sizeof(Int) == 1 ? coefficient_storage::int8 : coefficient_storage::int16);
+	tile_extents = newExtents;
+	coefficient_offsets = newOffsets;
+	cleanup.offsets = NULL;
+	return(maxError);
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_QUANTIZATION_H
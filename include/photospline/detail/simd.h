@@ -12,7 +12,6 @@
 
 #include "photospline/bspline.h"
 
-#define PHOTOSPLINE_MAXDIM	    8
 #define PHOTOSPLINE_VECTOR_SIZE 4
 
 #if __GNUC__ == 3
@@ -24,8 +23,6 @@ typedef float v4sf __attribute__(( mode(V4SF) ));
 typedef float v4sf __attribute__((vector_size(PHOTOSPLINE_VECTOR_SIZE*sizeof(float))));
 #endif
 
-#define PHOTOSPLINE_NVECS PHOTOSPLINE_MAXDIM/PHOTOSPLINE_VECTOR_SIZE
-
 #if defined(__i386__) || defined (__x86_64__)
 #define v4sf_init(a, b) a = _mm_set1_ps(b)
 #elif defined(__powerpc__)
@@ -44,4 +41,106 @@ typedef float v4sf __attribute__((vector_size(PHOTOSPLINE_VECTOR_SIZE*sizeof(flo
 }
 #endif
 
+/*
+ * On x86 with GCC-compatible compilers, wider versions of the gradient
+ * evaluation kernels are compiled for AVX2 and AVX-512 using function target
+ * attributes, in addition to those built with the baseline compiler flags,
+ * and the widest one which is useful is chosen at runtime. Define
+ * PHOTOSPLINE_NO_SIMD_DISPATCH to build only the baseline kernels.
+ */
+#if (defined(__i386__) || defined (__x86_64__)) && defined(__GNUC__) \
+    && !defined(PHOTOSPLINE_NO_SIMD_DISPATCH)
+#define PHOTOSPLINE_SIMD_DISPATCH 1
+#endif
+
+namespace photospline{
+
+///The instruction set variants for which evaluation kernels may be built
+enum class simd_variant{
+	generic, ///< whatever the library was compiled for, without x86 extensions
+	sse4_2, ///< 128-bit vectors
+	avx2, ///< 256-bit vectors
+	avx512 ///< 512-bit vectors
+};
+
+///Get a human-readable name for a SIMD variant
+inline const char* simd_variant_name(simd_variant variant){
+	switch(variant){
+		case simd_variant::sse4_2: return("SSE4.2");
+		case simd_variant::avx2: return("AVX2");
+		case simd_variant::avx512: return("AVX-512");
+		default: return("generic");
+	}
+}
+
+///Get the number of single precision lanes in the vectors used by a variant
+inline unsigned int simd_variant_width(simd_variant variant){
+	switch(variant){
+		case simd_variant::avx2: return(8);
+		case simd_variant::avx512: return(16);
+		default: return(PHOTOSPLINE_VECTOR_SIZE);
+	}
+}
+
+namespace detail{
+
+#ifdef PHOTOSPLINE_SIMD_DISPATCH
+typedef float v8sf __attribute__((vector_size(8*sizeof(float))));
+typedef float v16sf __attribute__((vector_size(16*sizeof(float))));
+//Unaligned, aliasing versions of the wider vector types, for viewing arrays
+//of v4sf. These must not be passed directly as template arguments, since
+//that would discard their attributes.
+template<typename Vec> struct unaligned_vector;
+template<> struct unaligned_vector<v8sf>{
+	typedef float type __attribute__((vector_size(8*sizeof(float)), aligned(sizeof(v4sf)), __may_alias__));
+};
+template<> struct unaligned_vector<v16sf>{
+	typedef float type __attribute__((vector_size(16*sizeof(float)), aligned(sizeof(v4sf)), __may_alias__));
+};
+#endif
+
+///Double precision vectors with as many lanes as v4sf
+typedef double v4df __attribute__((vector_size(PHOTOSPLINE_VECTOR_SIZE*sizeof(double))));
+
+///Round each lane of a v4df to single precision, keeping it as double
+#if defined(__clang__) || __GNUC__ >= 9
+#define V4DF_ROUND_TO_FLOAT(v) \
+	__builtin_convertvector(__builtin_convertvector((v), v4sf), v4df)
+#else
+#define V4DF_ROUND_TO_FLOAT(v) v4df_round_to_float(v)
+inline v4df v4df_round_to_float(v4df v){
+	for (unsigned int k = 0; k < PHOTOSPLINE_VECTOR_SIZE; k++)
+		v[k] = float(v[k]);
+	return(v);
+}
+#endif
+
+///Get the variant which the baseline compiler flags target
+constexpr simd_variant baseline_simd_variant(){
+#ifdef __SSE4_2__
+	return(simd_variant::sse4_2);
+#else
+	return(simd_variant::generic);
+#endif
+}
+
+///Determine the best variant which the current CPU can execute.
+///The result is computed once and cached.
+inline simd_variant cpu_simd_variant(){
+	static const simd_variant variant=[]{
+#ifdef PHOTOSPLINE_SIMD_DISPATCH
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx512f"))
+			return(simd_variant::avx512);
+		if(__builtin_cpu_supports("avx2"))
+			return(simd_variant::avx2);
+#endif
+		return(baseline_simd_variant());
+	}();
+	return(variant);
+}
+
+} //namespace detail
+} //namespace photospline
+
 #endif //PHOTOSPLINE_SIMD_H
@@ -0,0 +1,56 @@
+#ifndef PHOTOSPLINE_STATIC_EVAL_H
+#define PHOTOSPLINE_STATIC_EVAL_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+template<typename Alloc>
+template<unsigned int ... Orders>
+constexpr unsigned int splinetable<Alloc>::static_evaluator<Orders...>::D;
+template<typename Alloc>
+template<unsigned int ... Orders>
+constexpr unsigned int splinetable<Alloc>::static_evaluator<Orders...>::maxdegree;
+
+template<typename Alloc>
+template<unsigned int ... Orders>
+splinetable<Alloc>::static_evaluator<Orders...>::static_evaluator(const splinetable<Alloc>& table):
+table(table){
+	const unsigned int* knownOrder = detail::order_list<Orders...>::values;
+	if (table.ndim != D)
+		throw std::runtime_error("Static evaluator has "+std::to_string(D)+
+		                         " dimensions, but the table has "+std::to_string(table.ndim));
+	for (uint32_t n = 0; n < D; n++) {
+		if (table.order[n] != knownOrder[n])
+			throw std::runtime_error("Static evaluator has order "+std::to_string(knownOrder[n])+
+			                         " in dimension "+std::to_string(n)+
+			                         ", but the table has order "+std::to_string(table.order[n]));
+	}
+	table.require_standard_coefficients("Static evaluation");
+	
+	search.reserve(D);
+	for (uint32_t n = 0; n < D; n++)
+		search.emplace_back(&table.knots[n][0], table.nknots[n], table.order[n], table.naxes[n]);
+}
+
+template<typename Alloc>
+template<unsigned int ... Orders>
+double splinetable<Alloc>::static_evaluator<Orders...>::ndsplineeval(const double* x, const int* centers, int derivatives) const{
+	const unsigned int* knownOrder = detail::order_list<Orders...>::values;
+	float localbasis_store[D*maxdegree];
+	detail::buffer2d<float> localbasis{localbasis_store,maxdegree};
+	for (uint32_t n = 0; n < D; n++) {
+		const detail::knot_search& dim = search[n];
+		if (derivatives & (1 << n))
+			bspline_deriv_nonzero(dim.knots, dim.nknots, x[n], centers[n],
+			                      knownOrder[n], localbasis[n]);
+		else
+			bsplvb_simple(dim.knots, dim.nknots, x[n], centers[n],
+			              knownOrder[n] + 1, localbasis[n]);
+	}
+	return(table.template ndsplineeval_core_KnownOrder<Orders...>(centers, maxdegree, localbasis));
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_STATIC_EVAL_H
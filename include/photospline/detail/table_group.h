@@ -0,0 +1,166 @@
+#ifndef PHOTOSPLINE_TABLE_GROUP_H
+#define PHOTOSPLINE_TABLE_GROUP_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+namespace detail{
+
+///Get the first of a list of tables, which must not be empty
+template<typename Table>
+const Table& first_table(const std::vector<const Table*>& tables){
+	if (tables.empty())
+		throw std::runtime_error("A table group must contain at least one table");
+	return(*tables.front());
+}
+
+} //namespace detail
+
+template<typename Alloc>
+splinetable<Alloc>::table_group::table_group(const std::vector<const splinetable<Alloc>*>& tables):
+eval(detail::first_table(tables).get_evaluator()),ntables(tables.size()),
+wide(tables.size()),slots(tables.size()),nnarrow(0),nwide(0){
+	const splinetable<Alloc>& first = *tables.front();
+	for (const splinetable<Alloc>* table : tables) {
+		bool compatible = (table->ndim == first.ndim);
+		for (uint32_t n = 0; compatible && n < first.ndim; n++) {
+			compatible = (table->order[n] == first.order[n]
+			              && table->nknots[n] == first.nknots[n]
+			              && table->naxes[n] == first.naxes[n]
+			              && std::equal(&table->knots[n][0], &table->knots[n][0] + first.nknots[n],
+			                            &first.knots[n][0]));
+		}
+		if (!compatible)
+			throw std::runtime_error("Tables in a group must have the same dimensions, orders, and knots");
+	}
+	
+	for (uint32_t t = 0; t < ntables; t++) {
+		wide[t] = (tables[t]->storage == coefficient_storage::float64);
+		slots[t] = (wide[t] ? nwide++ : nnarrow++);
+	}
+	
+	const uint64_t ncoeffs = first.get_ncoeffs(), chunk = 1ULL<<16;
+	coefficients.resize(ncoeffs*nnarrow);
+	wide_coefficients.resize(ncoeffs*nwide);
+	std::unique_ptr<double[]> buffer(new double[chunk]);
+	for (uint32_t t = 0; t < ntables; t++) {
+		for (uint64_t start = 0; start < ncoeffs; start += chunk) {
+			uint64_t n = std::min(chunk, ncoeffs - start);
+			tables[t]->gather_coefficients(start, n, buffer.get());
+			if (wide[t]) {
+				for (uint64_t k = 0; k < n; k++)
+					wide_coefficients[(start + k)*nwide + slots[t]] = buffer[k];
+			} else {
+				for (uint64_t k = 0; k < n; k++)
+					coefficients[(start + k)*nnarrow + slots[t]] = buffer[k];
+			}
+		}
+	}
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::table_group::ndsplineeval(const double* x, const int* centers, double* results, int derivatives) const{
+	//the evaluator's snapshot of the knots and orders, and the strides,
+	//are read through plain pointers whatever the table's allocator
+	const uint32_t ndim = eval.get_table().ndim;
+	const detail::knot_search* search = &eval.search[0];
+	const uint64_t* strides = &eval.get_table().strides[0];
+	const uint32_t maxdegree = eval.maxdegree;
+	float localbasis_store[ndim*maxdegree];
+	detail::buffer2d<float> localbasis{localbasis_store,maxdegree};
+	
+	for (uint32_t n = 0; n < ndim; n++) {
+		if (!eval.reciprocals.empty()) {
+			const double* recip = eval.reciprocals[n].data();
+			if (derivatives & (1 << n))
+				bspline_deriv_nonzero_reciprocal(search[n].knots, recip, search[n].nknots,
+				                                 x[n], centers[n], search[n].order, localbasis[n]);
+			else
+				bsplvb_simple_reciprocal(search[n].knots, recip, search[n].nknots,
+				                         x[n], centers[n], search[n].order + 1, localbasis[n]);
+		} else if (derivatives & (1 << n)) {
+			bspline_deriv_nonzero(search[n].knots,
+								  search[n].nknots, x[n], centers[n],
+								  search[n].order, localbasis[n]);
+		} else {
+			bsplvb_simple(search[n].knots, search[n].nknots,
+						  x[n], centers[n], search[n].order + 1,
+						  localbasis[n]);
+		}
+	}
+	
+	/*
+	 * This is ndsplineeval_core, except that each weight is applied to
+	 * the coefficients of all of the tables, which are contiguous. Tables
+	 * stored in double precision are accumulated in double precision, as
+	 * their own kernels do.
+	 */
+	float basis_tree[ndim+1];
+	int decomposedposition[ndim];
+	float result[nnarrow];
+	double wide_result[nwide];
+	std::fill_n(result, nnarrow, 0.f);
+	std::fill_n(wide_result, nwide, 0.);
+	
+	int64_t tablepos = 0;
+	for (uint32_t n = 0; n < ndim; n++) {
+		decomposedposition[n] = 0;
+		tablepos += (centers[n] - (int64_t)search[n].order)*(int64_t)strides[n];
+	}
+	
+	basis_tree[0] = 1;
+	for (uint32_t n = 0; n < ndim; n++)
+		basis_tree[n+1] = basis_tree[n]*localbasis[n][0];
+	uint32_t nchunks = 1;
+	for (uint32_t n = 0; n + 1 < ndim; n++)
+		nchunks *= (search[n].order + 1);
+	
+	uint32_t n = 0;
+	while (true) {
+		for (uint32_t i = 0; __builtin_expect(i < search[ndim-1].order + 1, 1); i++) {
+			const float weight = basis_tree[ndim-1]*localbasis[ndim-1][i];
+			const float* coeffs = &coefficients[(tablepos + i)*nnarrow];
+			for (uint32_t t = 0; t < nnarrow; t++)
+				result[t] += weight*coeffs[t];
+			const double* wide_coeffs = &wide_coefficients[(tablepos + i)*nwide];
+			for (uint32_t t = 0; t < nwide; t++)
+				wide_result[t] += weight*wide_coeffs[t];
+		}
+		
+		if (__builtin_expect(++n == nchunks, 0))
+			break;
+		
+		tablepos += strides[ndim-2];
+		decomposedposition[ndim-2]++;
+		
+		// Carry to higher dimensions
+		uint32_t i;
+		for (i = ndim-2;
+			decomposedposition[i] > search[i].order; i--) {
+			decomposedposition[i-1]++;
+			tablepos += (strides[i-1] - decomposedposition[i]*strides[i]);
+			decomposedposition[i] = 0;
+		}
+		for (uint32_t j = i; __builtin_expect(j < ndim-1, 1); j++)
+			basis_tree[j+1] = basis_tree[j]*
+			localbasis[j][decomposedposition[j]];
+	}
+	
+	for (uint32_t t = 0; t < ntables; t++)
+		results[t] = (wide[t] ? wide_result[slots[t]] : result[slots[t]]);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::table_group::operator()(const double* x, double* results, int derivatives) const{
+	int centers[get_table().ndim];
+	if (!searchcenters(x, centers)) {
+		std::fill_n(results, ntables, 0.);
+		return;
+	}
+	ndsplineeval(x, centers, results, derivatives);
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_TABLE_GROUP_H
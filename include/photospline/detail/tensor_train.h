@@ -0,0 +1,438 @@
+#ifndef PHOTOSPLINE_TENSOR_TRAIN_H
+#define PHOTOSPLINE_TENSOR_TRAIN_H
+
+#include <cmath>
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+namespace detail{
+
+/*
+ * Find the eigenvalues and eigenvectors of the symmetric n by n matrix a,
+ * stored in row-major order, by Householder reduction to tridiagonal form
+ * followed by the implicit QL method (the EISPACK tred2 and tql2
+ * routines). On return the eigenvalues are in values in descending order,
+ * and a holds the corresponding normalized eigenvectors as its columns.
+ */
+inline void symmetric_eigen(std::vector<double>& a, uint64_t n, std::vector<double>& values){
+	std::vector<double>& v = a;
+	std::vector<double>& d = values;
+	std::vector<double> e(n);
+	d.resize(n);
+	if (n == 0)
+		return;
+	
+	//Householder reduction to tridiagonal form
+	for (uint64_t j = 0; j < n; j++)
+		d[j] = v[(n-1)*n + j];
+	for (uint64_t i = n - 1; i > 0; i--) {
+		double scale = 0, h = 0;
+		for (uint64_t k = 0; k < i; k++)
+			scale += std::abs(d[k]);
+		if (scale == 0) {
+			e[i] = d[i-1];
+			for (uint64_t j = 0; j < i; j++) {
+				d[j] = v[(i-1)*n + j];
+				v[i*n + j] = 0;
+				v[j*n + i] = 0;
+			}
+		} else {
+			for (uint64_t k = 0; k < i; k++) {
+				d[k] /= scale;
+				h += d[k]*d[k];
+			}
+			double f = d[i-1];
+			double g = std::sqrt(h);
+			if (f > 0)
+				g = -g;
+			e[i] = scale*g;
+			h -= f*g;
+			d[i-1] = f - g;
+			for (uint64_t j = 0; j < i; j++)
+				e[j] = 0;
+			for (uint64_t j = 0; j < i; j++) {
+				f = d[j];
+				v[j*n + i] = f;
+				g = e[j] + v[j*n + j]*f;
+				for (uint64_t k = j + 1; k < i; k++) {
+					g += v[k*n + j]*d[k];
+					e[k] += v[k*n + j]*f;
+				}
+				e[j] = g;
+			}
+			f = 0;
+			for (uint64_t j = 0; j < i; j++) {
+				e[j] /= h;
+				f += e[j]*d[j];
+			}
+			const double hh = f/(h + h);
+			for (uint64_t j = 0; j < i; j++)
+				e[j] -= hh*d[j];
+			for (uint64_t j = 0; j < i; j++) {
+				f = d[j];
+				g = e[j];
+				for (uint64_t k = j; k < i; k++)
+					v[k*n + j] -= (f*e[k] + g*d[k]);
+				d[j] = v[(i-1)*n + j];
+				v[i*n + j] = 0;
+			}
+		}
+		d[i] = h;
+	}
+	
+	//accumulate the transformations
+	for (uint64_t i = 0; i + 1 < n; i++) {
+		v[(n-1)*n + i] = v[i*n + i];
+		v[i*n + i] = 1;
+		const double h = d[i+1];
+		if (h != 0) {
+			for (uint64_t k = 0; k <= i; k++)
+				d[k] = v[k*n + i + 1]/h;
+			for (uint64_t j = 0; j <= i; j++) {
+				double g = 0;
+				for (uint64_t k = 0; k <= i; k++)
+					g += v[k*n + i + 1]*v[k*n + j];
+				for (uint64_t k = 0; k <= i; k++)
+					v[k*n + j] -= g*d[k];
+			}
+		}
+		for (uint64_t k = 0; k <= i; k++)
+			v[k*n + i + 1] = 0;
+	}
+	for (uint64_t j = 0; j < n; j++) {
+		d[j] = v[(n-1)*n + j];
+		v[(n-1)*n + j] = 0;
+	}
+	v[(n-1)*n + n - 1] = 1;
+	e[0] = 0;
+	
+	//implicit QL iterations on the tridiagonal matrix
+	for (uint64_t i = 1; i < n; i++)
+		e[i-1] = e[i];
+	e[n-1] = 0;
+	double f = 0, tst1 = 0;
+	const double eps = std::numeric_limits<double>::epsilon();
+	for (uint64_t l = 0; l < n; l++) {
+		tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+		uint64_t m = l;
+		while (m < n - 1 && std::abs(e[m]) > eps*tst1)
+			m++;
+		if (m > l) {
+			do {
+				double g = d[l];
+				double p = (d[l+1] - g)/(2*e[l]);
+				double r = std::hypot(p, 1.);
+				if (p < 0)
+					r = -r;
+				d[l] = e[l]/(p + r);
+				d[l+1] = e[l]*(p + r);
+				const double dl1 = d[l+1];
+				double h = g - d[l];
+				for (uint64_t i = l + 2; i < n; i++)
+					d[i] -= h;
+				f += h;
+				
+				p = d[m];
+				double c = 1, c2 = c, c3 = c, s = 0, s2 = 0;
+				const double el1 = e[l+1];
+				for (uint64_t i = m; i-- > l; ) {
+					c3 = c2;
+					c2 = c;
+					s2 = s;
+					g = c*e[i];
+					h = c*p;
+					r = std::hypot(p, e[i]);
+					e[i+1] = s*r;
+					s = e[i]/r;
+					c = p/r;
+					p = c*d[i] - s*g;
+					d[i+1] = h + s*(c*g + s*d[i]);
+					for (uint64_t k = 0; k < n; k++) {
+						h = v[k*n + i + 1];
+						v[k*n + i + 1] = s*v[k*n + i] + c*h;
+						v[k*n + i] = c*v[k*n + i] - s*h;
+					}
+				}
+				p = -s*s2*c3*el1*e[l]/dl1;
+				e[l] = s*p;
+				d[l] = c*p;
+			} while (std::abs(e[l]) > eps*tst1);
+		}
+		d[l] += f;
+		e[l] = 0;
+	}
+	
+	//sort into descending order of eigenvalue
+	for (uint64_t i = 0; i + 1 < n; i++) {
+		uint64_t k = i;
+		for (uint64_t j = i + 1; j < n; j++) {
+			if (d[j] > d[k])
+				k = j;
+		}
+		if (k != i) {
+			std::swap(d[i], d[k]);
+			for (uint64_t j = 0; j < n; j++)
+				std::swap(v[j*n + i], v[j*n + k]);
+		}
+	}
+}
+
+///The number of columns of an unfolding processed together, so that a block
+///of all of its rows stays in cache
+constexpr uint64_t unfolding_block = 256;
+
+///Compute gram = c*c^T for the row-major rows by cols matrix c
+template<typename T>
+void unfolding_gram(const T* c, uint64_t rows, uint64_t cols, double* gram){
+	std::fill_n(gram, rows*rows, 0.);
+	for (uint64_t start = 0; start < cols; start += unfolding_block) {
+		const uint64_t end = std::min(cols, start + unfolding_block);
+		for (uint64_t p = 0; p < rows; p++) {
+			const T* rp = c + p*cols;
+			for (uint64_t q = 0; q <= p; q++) {
+				const T* rq = c + q*cols;
+				double sum = 0;
+				for (uint64_t k = start; k < end; k++)
+					sum += double(rp[k])*rq[k];
+				gram[p*rows + q] += sum;
+			}
+		}
+	}
+	for (uint64_t p = 0; p < rows; p++) {
+		for (uint64_t q = 0; q < p; q++)
+			gram[q*rows + p] = gram[p*rows + q];
+	}
+}
+
+///Compute out = u^T*c, where c is a row-major rows by cols matrix and u is
+///formed by the first rank columns of the row-major rows by rows matrix basis
+template<typename T>
+void project_unfolding(const T* c, uint64_t rows, uint64_t cols,
+                       const double* basis, uint32_t rank, double* out){
+	std::fill_n(out, rank*cols, 0.);
+	for (uint64_t start = 0; start < cols; start += unfolding_block) {
+		const uint64_t end = std::min(cols, start + unfolding_block);
+		for (uint32_t j = 0; j < rank; j++) {
+			double* o = out + j*cols;
+			for (uint64_t p = 0; p < rows; p++) {
+				const double u = basis[p*rows + j];
+				const T* rp = c + p*cols;
+				for (uint64_t k = start; k < end; k++)
+					o[k] += u*rp[k];
+			}
+		}
+	}
+}
+
+///Compute gram = c^T*c for the row-major rows by cols matrix c
+template<typename T>
+void unfolding_column_gram(const T* c, uint64_t rows, uint64_t cols, double* gram){
+	std::fill_n(gram, cols*cols, 0.);
+	for (uint64_t r = 0; r < rows; r++) {
+		const T* row = c + r*cols;
+		for (uint64_t p = 0; p < cols; p++) {
+			const double v = row[p];
+			for (uint64_t q = 0; q <= p; q++)
+				gram[p*cols + q] += v*row[q];
+		}
+	}
+	for (uint64_t p = 0; p < cols; p++) {
+		for (uint64_t q = 0; q < p; q++)
+			gram[q*cols + p] = gram[p*cols + q];
+	}
+}
+
+/*
+ * Truncate the singular value decomposition of the row-major rows by cols
+ * matrix c, c ~ left*next, keeping the largest singular values such that the
+ * sum of the squares of those discarded is within allowance, and at most
+ * maxRank of them. left is rows by rank with orthonormal columns, and next
+ * is rank by cols, both row-major. The singular values come from the
+ * eigenvalues of the smaller of c*c^T and c^T*c. Those too small to be told
+ * apart from rounding in the Gram matrix are always discarded; that and
+ * maxRank may exceed the allowance. Returns the rank, and adds the sum of
+ * the squares of the discarded singular values to discarded.
+ */
+template<typename T>
+uint32_t truncate_unfolding(const T* c, uint64_t rows, uint64_t cols, double allowance,
+                            uint32_t maxRank, std::vector<double>& left,
+                            std::vector<double>& next, double& discarded){
+	const bool wide = (rows <= cols);
+	const uint64_t size = (wide ? rows : cols);
+	std::vector<double> gram(size*size), values;
+	if (wide)
+		unfolding_gram(c, rows, cols, gram.data());
+	else
+		unfolding_column_gram(c, rows, cols, gram.data());
+	symmetric_eigen(gram, size, values);
+	
+	const double noise = std::max(values[0], 0.)*size*std::numeric_limits<double>::epsilon();
+	uint32_t rank = size;
+	double dropped = 0;
+	while (rank > 1 && (rank > maxRank || values[rank-1] <= noise
+	                    || dropped + std::max(values[rank-1], 0.) <= allowance))
+		dropped += std::max(values[--rank], 0.);
+	discarded += dropped;
+	
+	left.assign(rows*rank, 0.);
+	next.assign(rank*cols, 0.);
+	if (wide) {
+		//the eigenvectors are the left singular vectors
+		for (uint64_t p = 0; p < rows; p++)
+			std::copy_n(&gram[p*size], rank, &left[p*rank]);
+		project_unfolding(c, rows, cols, gram.data(), rank, next.data());
+	} else {
+		//the eigenvectors are the right singular vectors, v, and left is
+		//c*v scaled by the reciprocals of the singular values
+		for (uint32_t j = 0; j < rank; j++) {
+			const double sigma = std::sqrt(std::max(values[j], 0.));
+			const double scale = (sigma > 0 ? 1/sigma : 0);
+			for (uint64_t q = 0; q < cols; q++)
+				next[j*cols + q] = sigma*gram[q*size + j];
+			for (uint64_t p = 0; p < rows; p++) {
+				double sum = 0;
+				for (uint64_t q = 0; q < cols; q++)
+					sum += c[p*cols + q]*gram[q*size + j];
+				left[p*rank + j] = sum*scale;
+			}
+		}
+	}
+	return(rank);
+}
+
+} //namespace detail
+
+template<typename Alloc>
+splinetable<Alloc>::tensor_train::tensor_train(const splinetable<Alloc>& table, double tolerance, uint32_t maxRank):
+eval(table.get_evaluator()),ndim(table.ndim),ranks(table.ndim+1,1),maxrank(1),
+maxdegree(*std::max_element(&table.order[0], &table.order[0] + table.ndim) + 1),
+cores(table.ndim),error(0){
+	if (!(tolerance >= 0))
+		throw std::runtime_error("The tolerance of a tensor train must not be negative");
+	if (maxRank == 0)
+		throw std::runtime_error("The ranks of a tensor train must be at least one");
+	
+	const uint64_t ncoeffs = table.get_ncoeffs(), chunk = 1ULL<<16;
+	std::vector<float> full(ncoeffs);
+	{
+		std::unique_ptr<double[]> buffer(new double[chunk]);
+		for (uint64_t start = 0; start < ncoeffs; start += chunk) {
+			uint64_t n = std::min(chunk, ncoeffs - start);
+			table.gather_coefficients(start, n, buffer.get());
+			std::copy_n(buffer.get(), n, &full[start]);
+		}
+	}
+	
+	/*
+	 * TT-SVD: the remaining part of the tensor is unfolded into a matrix
+	 * whose rows are indexed by the rank of the previous core and the
+	 * coefficient index of the current dimension, and whose columns are
+	 * indexed by the coefficients of the later dimensions. Its leading left
+	 * singular vectors become the core, and their projection of it, which
+	 * in row-major order is already the next unfolding, becomes the
+	 * remainder. Splitting the allowed squared error evenly between the
+	 * ndim-1 truncations keeps the total within the tolerance, and since
+	 * each truncation is orthogonal to the others the squared errors add
+	 * exactly.
+	 */
+	const double allowance = (ndim > 1 ? tolerance*tolerance/(ndim - 1) : 0);
+	double squaredError = 0;
+	std::vector<double> rest, left, next;
+	uint64_t cols = ncoeffs;
+	for (uint32_t n = 0; n + 1 < ndim; n++) {
+		const uint64_t naxes = table.naxes[n];
+		const uint64_t rows = ranks[n]*naxes;
+		cols /= naxes;
+		uint32_t rank;
+		if (n == 0) {
+			rank = detail::truncate_unfolding(full.data(), rows, cols, allowance, maxRank,
+			                                  left, next, squaredError);
+			std::vector<float>().swap(full);
+		} else {
+			rank = detail::truncate_unfolding(rest.data(), rows, cols, allowance, maxRank,
+			                                  left, next, squaredError);
+		}
+		ranks[n+1] = rank;
+		maxrank = std::max(maxrank, rank);
+		rest.swap(next);
+		
+		cores[n].resize(naxes*ranks[n]*rank);
+		for (uint32_t i = 0; i < ranks[n]; i++) {
+			for (uint64_t a = 0; a < naxes; a++)
+				std::copy_n(&left[(i*naxes + a)*rank], rank, &cores[n][(a*ranks[n] + i)*rank]);
+		}
+	}
+	
+	//the last core is what remains
+	const uint32_t last = ndim - 1;
+	const uint64_t naxes = table.naxes[last];
+	cores[last].resize(naxes*ranks[last]);
+	for (uint32_t i = 0; i < ranks[last]; i++) {
+		for (uint64_t a = 0; a < naxes; a++)
+			cores[last][a*ranks[last] + i] = (ndim == 1 ? full[a] : rest[i*naxes + a]);
+	}
+	error = std::sqrt(squaredError);
+}
+
+template<typename Alloc>
+double splinetable<Alloc>::tensor_train::ndsplineeval(const double* x, const int* centers, int derivatives) const{
+	//the knots and orders are read through the evaluator's plain pointers
+	const detail::knot_search* search = &eval.search[0];
+	float localbasis[maxdegree];
+	float left_store[maxrank], right_store[maxrank];
+	float* left = left_store;
+	float* right = right_store;
+	left[0] = 1;
+	
+	/*
+	 * Carry the row vector formed by contracting the earlier dimensions
+	 * through each core in turn, weighting the matrices of the coefficients
+	 * supporting x by their basis functions.
+	 */
+	for (uint32_t n = 0; n < ndim; n++) {
+		const uint32_t order = search[n].order;
+		if (derivatives & (1 << n)) {
+			bspline_deriv_nonzero(search[n].knots, search[n].nknots,
+			                      x[n], centers[n], order, localbasis);
+		} else {
+			bsplvb_simple(search[n].knots, search[n].nknots,
+			              x[n], centers[n], order + 1, localbasis);
+		}
+		
+		const uint32_t r0 = ranks[n], r1 = ranks[n+1];
+		const float* matrix = &cores[n][(centers[n] - order)*r0*r1];
+		std::fill_n(right, r1, 0.f);
+		for (uint32_t k = 0; k <= order; k++) {
+			for (uint32_t i = 0; i < r0; i++) {
+				const float weight = localbasis[k]*left[i];
+				for (uint32_t j = 0; j < r1; j++)
+					right[j] += weight*matrix[j];
+				matrix += r1;
+			}
+		}
+		std::swap(left, right);
+	}
+	return(left[0]);
+}
+
+template<typename Alloc>
+double splinetable<Alloc>::tensor_train::operator()(const double* x, int derivatives) const{
+	int centers[ndim];
+	if (!searchcenters(x, centers))
+		return(0);
+	return(ndsplineeval(x, centers, derivatives));
+}
+
+template<typename Alloc>
+size_t splinetable<Alloc>::tensor_train::memory_usage() const{
+	size_t size = 0;
+	for (const std::vector<float>& core : cores)
+		size += core.size()*sizeof(float);
+	return(size);
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_TENSOR_TRAIN_H
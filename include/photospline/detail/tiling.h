@@ -0,0 +1,245 @@
+#ifndef PHOTOSPLINE_TILING_H
+#define PHOTOSPLINE_TILING_H
+
+#include "photospline/splinetable.h"
+
+namespace photospline{
+
+namespace detail{
+
+///Choose the number of coefficients along one dimension of a tile, for a
+///dimension with n coefficients. This is the requested size, or up to half
+///again as much if that leaves less of the last tile as padding.
+inline uint32_t choose_tile_extent(uint64_t n, uint32_t tileSize){
+	if (n <= tileSize)
+		return(n);
+	uint32_t best = tileSize;
+	uint64_t bestPadding = (n + tileSize - 1)/tileSize*tileSize - n;
+	for (uint32_t t = tileSize + 1; t <= tileSize + tileSize/2 && bestPadding; t++) {
+		uint64_t padding = (n + t - 1)/t*t - n;
+		if (padding < bestPadding) {
+			best = t;
+			bestPadding = padding;
+		}
+	}
+	return(best);
+}
+
+} //namespace detail
+
+template<typename Alloc>
+uint64_t splinetable<Alloc>::stored_ncoeffs() const{
+	if (!tile_extents)
+		return(strides[0]*naxes[0]);
+	uint64_t n = 1;
+	for (uint32_t i = 0; i < ndim; i++)
+		n *= (naxes[i] + tile_extents[i] - 1)/tile_extents[i]*tile_extents[i];
+	return(n);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::gather_coefficients(uint64_t first, uint64_t n, double* out) const{
+	switch (storage) {
+		case coefficient_storage::float16: gather_coefficients<detail::half>(first, n, out); break;
+		case coefficient_storage::bfloat16: gather_coefficients<detail::bfloat16>(first, n, out); break;
+		case coefficient_storage::float64: gather_coefficients<double>(first, n, out); break;
+		case coefficient_storage::int8: gather_coefficients<detail::block_quantized<int8_t>>(first, n, out); break;
+		case coefficient_storage::int16: gather_coefficients<detail::block_quantized<int16_t>>(first, n, out); break;
+		default: gather_coefficients<float>(first, n, out);
+	}
+}
+
+template<typename Alloc>
+template<typename Coeff>
+void splinetable<Alloc>::gather_coefficients(uint64_t first, uint64_t n, double* out) const{
+	const detail::coefficient_reader<Coeff> coefficient = stored_coefficients<Coeff>();
+	if (!coefficient_offsets) {
+		for (uint64_t k = 0; k < n; k++)
+			out[k] = coefficient(first + k);
+		return;
+	}
+	std::unique_ptr<uint64_t[]> index(new uint64_t[ndim]);
+	for (uint32_t i = 0; i < ndim; i++)
+		index[i] = first/strides[i] % naxes[i];
+	for (uint64_t k = 0; k < n; k++) {
+		uint64_t pos = 0;
+		for (uint32_t i = 0; i < ndim; i++)
+			pos += coefficient_offsets[i][index[i]];
+		out[k] = coefficient(pos);
+		for (uint32_t i = ndim; i-- > 0; ) {
+			if (++index[i] < naxes[i])
+				break;
+			index[i] = 0;
+		}
+	}
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::release_coefficients(){
+	uint64_t nstored = stored_ncoeffs();
+	switch (storage) {
+		case coefficient_storage::float16:
+			deallocate((detail::half*)&packed_coefficients[0], nstored);
+			break;
+		case coefficient_storage::bfloat16:
+			deallocate((detail::bfloat16*)&packed_coefficients[0], nstored);
+			break;
+		case coefficient_storage::float64:
+			deallocate((double*)&packed_coefficients[0], nstored);
+			break;
+		case coefficient_storage::int8:
+			deallocate((int8_t*)&packed_coefficients[0], nstored);
+			break;
+		case coefficient_storage::int16:
+			deallocate((int16_t*)&packed_coefficients[0], nstored);
+			break;
+		default:
+			deallocate(coefficients, nstored);
+	}
+	if (block_parameters) {
+		uint64_t tileSize = std::accumulate(tile_extents, tile_extents+ndim, 1ULL, std::multiplies<uint64_t>());
+		deallocate(block_parameters, 2*(nstored/tileSize));
+	}
+	coefficients = NULL;
+	packed_coefficients = NULL;
+	block_parameters = NULL;
+	block_shift = 0;
+	storage = coefficient_storage::float32;
+	if (coefficient_offsets) {
+		deallocate(coefficient_offsets[0], std::accumulate(naxes, naxes+ndim, 0ULL));
+		deallocate(coefficient_offsets, ndim);
+		coefficient_offsets = NULL;
+	}
+	if (tile_extents) {
+		deallocate(tile_extents, ndim);
+		tile_extents = NULL;
+	}
+}
+
+template<typename Alloc>
+typename splinetable<Alloc>::uint64_t_ptr_ptr
+splinetable<Alloc>::make_coefficient_offsets(const uint32_t* tileExtents, uint64_t& nstored){
+	uint64_t_ptr_ptr offsets = allocate<uint64_t_ptr>(ndim);
+	offsets[0] = allocate<uint64_t>(std::accumulate(naxes, naxes+ndim, 0ULL));
+	for (uint32_t i = 1; i < ndim; i++)
+		offsets[i] = &offsets[i-1][naxes[i-1]];
+	if (!tileExtents) {
+		for (uint32_t i = 0; i < ndim; i++) {
+			for (uint64_t j = 0; j < naxes[i]; j++)
+				offsets[i][j] = j*strides[i];
+		}
+		nstored = strides[0]*naxes[0];
+		return(offsets);
+	}
+	/*
+	 * The tiles are stored in row-major order, and so are the coefficients
+	 * within each tile, so the offset of the jth coefficient along dimension
+	 * i is the offset of its tile plus its offset within the tile.
+	 */
+	uint64_t tileSize = std::accumulate(tileExtents, tileExtents+ndim, 1ULL, std::multiplies<uint64_t>());
+	uint64_t innerStride = 1, tileStride = tileSize;
+	for (uint32_t i = ndim; i-- > 0; ) {
+		for (uint64_t j = 0; j < naxes[i]; j++)
+			offsets[i][j] = j/tileExtents[i]*tileStride + j%tileExtents[i]*innerStride;
+		innerStride *= tileExtents[i];
+		tileStride *= (naxes[i] + tileExtents[i] - 1)/tileExtents[i];
+	}
+	nstored = tileStride;
+	return(offsets);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::set_layout(const uint32_t* tileExtents, coefficient_storage newStorage){
+	switch (newStorage) {
+		case coefficient_storage::float16: set_layout<detail::half>(tileExtents, newStorage); break;
+		case coefficient_storage::bfloat16: set_layout<detail::bfloat16>(tileExtents, newStorage); break;
+		case coefficient_storage::float64: set_layout<double>(tileExtents, newStorage); break;
+		case coefficient_storage::float32: set_layout<float>(tileExtents, newStorage); break;
+		default: throw std::runtime_error("Coefficients can only be quantized by quantize_coefficients");
+	}
+}
+
+template<typename Alloc>
+template<typename Coeff>
+void splinetable<Alloc>::set_layout(const uint32_t* tileExtents, coefficient_storage newStorage){
+	//the standard layout needs no offsets
+	uint64_t nstored = strides[0]*naxes[0];
+	uint64_t_ptr_ptr newOffsets = NULL;
+	if (tileExtents || newStorage != coefficient_storage::float32)
+		newOffsets = make_coefficient_offsets(tileExtents, nstored);
+	uint32_t_ptr newExtents = NULL;
+	if (tileExtents) {
+		newExtents = allocate<uint32_t>(ndim);
+		std::copy_n(tileExtents, ndim, newExtents);
+	}
+	
+	typename allocator_traits::template rebind_traits<Coeff>::pointer newCoefficients = allocate<Coeff>(nstored);
+	Coeff* data = &newCoefficients[0];
+	//partial tiles are padded with zeros
+	if (nstored != get_ncoeffs())
+		std::fill_n(data, nstored, Coeff());
+	const uint64_t ncoeffs = get_ncoeffs(), chunk = 1ULL<<16;
+	std::unique_ptr<double[]> buffer(new double[chunk]);
+	std::unique_ptr<uint64_t[]> index(new uint64_t[ndim]());
+	for (uint64_t first = 0; first < ncoeffs; first += chunk) {
+		uint64_t n = std::min(chunk, ncoeffs - first);
+		gather_coefficients(first, n, buffer.get());
+		for (uint64_t k = 0; k < n; k++) {
+			uint64_t pos = 0;
+			for (uint32_t i = 0; i < ndim; i++)
+				pos += newOffsets ? newOffsets[i][index[i]] : index[i]*strides[i];
+			detail::store_coefficient(buffer[k], data[pos]);
+			for (uint32_t i = ndim; i-- > 0; ) {
+				if (++index[i] < naxes[i])
+					break;
+				index[i] = 0;
+			}
+		}
+	}
+	
+	release_coefficients();
+	if (newStorage == coefficient_storage::float32)
+		coefficients = (float*)data;
+	else
+		packed_coefficients = (char*)data;
+	storage = newStorage;
+	tile_extents = newExtents;
+	coefficient_offsets = newOffsets;
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::tile_coefficients(uint32_t tileSize){
+	if (tileSize == 0)
+		throw std::runtime_error("Coefficient tiles must have a positive size");
+	if (is_quantized(storage))
+		throw std::runtime_error("Quantized coefficients cannot be retiled");
+	std::unique_ptr<uint32_t[]> tileExtents(new uint32_t[ndim]);
+	for (uint32_t i = 0; i < ndim; i++)
+		tileExtents[i] = detail::choose_tile_extent(naxes[i], tileSize);
+	set_layout(tileExtents.get(), storage);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::untile_coefficients(){
+	if (is_quantized(storage))
+		throw std::runtime_error("Quantized coefficients cannot be untiled");
+	if (tile_extents)
+		set_layout(NULL, storage);
+}
+
+template<typename Alloc>
+void splinetable<Alloc>::set_coefficient_storage(coefficient_storage newStorage){
+	if (newStorage == storage)
+		return;
+	if (!tile_extents)
+		set_layout(NULL, newStorage);
+	else {
+		std::unique_ptr<uint32_t[]> tileExtents(new uint32_t[ndim]);
+		std::copy_n(tile_extents, ndim, tileExtents.get());
+		set_layout(tileExtents.get(), newStorage);
+	}
+}
+
+} //namespace photospline
+
+#endif //PHOTOSPLINE_TILING_H
@@ -4,14 +4,19 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <memory>
 #include <numeric>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <cstdlib>
 
 #include "photospline/bspline.h"
 #include "photospline/detail/simd.h"
+#include "photospline/detail/knot_search.h"
+#include "photospline/detail/coefficient_storage.h"
 
 #include <string.h>
 #include <fitsio.h>
@@ -118,6 +123,13 @@ namespace detail{
 		iterator end() const{ return(d+s); }
 		const_iterator cend() const{ return(d+s); }
 	};
+	///The largest of a list of orders, at compile time
+	template<unsigned int O1>
+	constexpr unsigned int max_order(){ return(O1); }
+	template<unsigned int O1, unsigned int O2, unsigned int ... Orders>
+	constexpr unsigned int max_order(){
+		return(O1 > max_order<O2, Orders...>() ? O1 : max_order<O2, Orders...>());
+	}
 }
 	
 template<typename Alloc = std::allocator<void> >
@@ -128,6 +140,7 @@ public:
 	
 	typedef typename allocator_traits::template rebind_traits<uint32_t>::pointer uint32_t_ptr;
 	typedef typename allocator_traits::template rebind_traits<uint64_t>::pointer uint64_t_ptr;
+	typedef typename allocator_traits::template rebind_traits<uint64_t_ptr>::pointer uint64_t_ptr_ptr;
 	typedef typename allocator_traits::template rebind_traits<float>::pointer float_ptr;
 	typedef typename allocator_traits::template rebind_traits<double>::pointer double_ptr;
 	typedef typename allocator_traits::template rebind_traits<double_ptr>::pointer double_ptr_ptr;
@@ -139,14 +152,20 @@ public:
 	///The resulting object is useful only for calling read_fits, read_fits_mem, or fit.
 	explicit splinetable(allocator_type alloc=Alloc()):
 	ndim(0),order(NULL),knots(NULL),nknots(NULL),extents(NULL),periods(NULL),
-	coefficients(NULL),naxes(NULL),strides(NULL),naux(0),aux(NULL),allocator(alloc)
+	coefficients(NULL),naxes(NULL),strides(NULL),storage(coefficient_storage::float32),
+	packed_coefficients(NULL),block_parameters(NULL),block_shift(0),
+	tile_extents(NULL),coefficient_offsets(NULL),
+	naux(0),aux(NULL),allocator(alloc)
 	{}
 	
 	///Construct a splinetable from serialized data previously stored in a FITS file.
 	///\param filePath the path to the input file
 	explicit splinetable(const std::string& filePath, allocator_type alloc=Alloc()):
 	ndim(0),order(NULL),knots(NULL),nknots(NULL),extents(NULL),periods(NULL),
-	coefficients(NULL),naxes(NULL),strides(NULL),naux(0),aux(NULL),allocator(alloc)
+	coefficients(NULL),naxes(NULL),strides(NULL),storage(coefficient_storage::float32),
+	packed_coefficients(NULL),block_parameters(NULL),block_shift(0),
+	tile_extents(NULL),coefficient_offsets(NULL),
+	naux(0),aux(NULL),allocator(alloc)
 	{
 		read_fits(filePath);
 	}
@@ -157,7 +176,10 @@ public:
 	///\param stackOrder the order of the spline in the stacking dimension
 	explicit splinetable(std::vector<splinetable<Alloc>*> tables, std::vector<double> coordinates, int stackOrder=2, allocator_type alloc=Alloc()):
 	ndim(0),order(NULL),knots(NULL),nknots(NULL),extents(NULL),periods(NULL),
-	coefficients(NULL),naxes(NULL),strides(NULL),naux(0),aux(NULL),allocator(alloc)
+	coefficients(NULL),naxes(NULL),strides(NULL),storage(coefficient_storage::float32),
+	packed_coefficients(NULL),block_parameters(NULL),block_shift(0),
+	tile_extents(NULL),coefficient_offsets(NULL),
+	naux(0),aux(NULL),allocator(alloc)
 	{
     assert(!tables.empty());
     assert(tables.size()==coordinates.size());
@@ -165,6 +187,7 @@ public:
     for(auto table : tables){
       assert(table->get_ndim() == inputDim);
       assert(table->get_ncoeffs() && tables.front()->get_ncoeffs());
+      table->require_standard_coefficients("Stacking");
       for(unsigned int i=0; i<inputDim; i++){
         assert(table->get_order(i) && tables.front()->get_order(i));
       }
@@ -267,6 +290,18 @@ public:
       lastKnots[nknots[inputDim]-1]=2*lastKnots[nknots[inputDim]-2]-lastKnots[nknots[inputDim]-3];
     }
 
+    //copy the existing extents, and make up ones for the new dimension
+    extents=allocate<double_ptr>(ndim);
+    extents[0]=allocate<double>(2*ndim);
+    for(unsigned int i=0; i<ndim; i++)
+      extents[i]=&extents[0][2*i];
+    for(unsigned int i=0; i<inputDim; i++){
+      extents[i][0]=tables.front()->lower_extent(i);
+      extents[i][1]=tables.front()->upper_extent(i);
+    }
+    extents[inputDim][0]=knots[inputDim][order[inputDim]];
+    extents[inputDim][1]=knots[inputDim][nknots[inputDim]-order[inputDim]-1];
+
     //set naxes
     naxes=allocate<uint64_t>(ndim);
     for(unsigned int i=0; i<inputDim; i++)
@@ -299,6 +334,9 @@ public:
 	nknots(other.nknots),extents(std::move(other.extents)),
 	periods(std::move(other.periods)),coefficients(std::move(other.coefficients)),
 	naxes(std::move(other.naxes)),strides(std::move(other.strides)),
+	storage(other.storage),packed_coefficients(std::move(other.packed_coefficients)),
+	block_parameters(std::move(other.block_parameters)),block_shift(other.block_shift),
+	tile_extents(std::move(other.tile_extents)),coefficient_offsets(std::move(other.coefficient_offsets)),
 	naux(other.naux),aux(std::move(other.aux)),
 	allocator(std::move(other.allocator))
 	{
@@ -311,6 +349,12 @@ public:
 		other.coefficients=NULL;
 		other.naxes=NULL;
 		other.strides=NULL;
+		other.storage=coefficient_storage::float32;
+		other.packed_coefficients=NULL;
+		other.block_parameters=NULL;
+		other.block_shift=0;
+		other.tile_extents=NULL;
+		other.coefficient_offsets=NULL;
 		other.naux=0;
 		other.aux=NULL;
 		other.allocator=Alloc();
@@ -318,7 +362,6 @@ public:
 	
 	~splinetable(){
 		if(ndim){
-			uint64_t ncoeffs=strides[0]*naxes[0];
 			for(uint32_t i=0; i<ndim; i++)
 				deallocate(knots[i]-order[i],nknots[i]+2*order[i]);
 			deallocate(knots,ndim);
@@ -330,7 +373,7 @@ public:
 			}
 			if(periods)
 				deallocate(periods,ndim);
-			deallocate(coefficients,ncoeffs);
+			release_coefficients();
 			deallocate(naxes,ndim);
 			deallocate(strides,ndim);
 			for(uint32_t i=0; i<naux; i++){
@@ -355,6 +398,12 @@ public:
 		swap(coefficients,other.coefficients);
 		swap(naxes,other.naxes);
 		swap(strides,other.strides);
+		swap(storage,other.storage);
+		swap(packed_coefficients,other.packed_coefficients);
+		swap(block_parameters,other.block_parameters);
+		swap(block_shift,other.block_shift);
+		swap(tile_extents,other.tile_extents);
+		swap(coefficient_offsets,other.coefficient_offsets);
 		swap(naux,other.naux);
 		swap(aux,other.aux);
 		swap(allocator,other.allocator);
@@ -379,8 +428,18 @@ public:
 				return false;
 		if (get_ncoeffs() != other.get_ncoeffs())
 			return false;
-		if (!std::equal(coefficients,coefficients+get_ncoeffs(),other.coefficients))
-			return false;
+		if (!coefficient_offsets && !other.coefficient_offsets)
+			return(std::equal(coefficients,coefficients+get_ncoeffs(),other.coefficients));
+		//compare in the standard order, a piece at a time
+		const uint64_t ncoeffs=get_ncoeffs(), chunk=1ULL<<16;
+		std::unique_ptr<double[]> buffer(new double[2*chunk]);
+		for (uint64_t i=0; i<ncoeffs; i+=chunk) {
+			uint64_t n=std::min(chunk,ncoeffs-i);
+			gather_coefficients(i,n,buffer.get());
+			other.gather_coefficients(i,n,buffer.get()+chunk);
+			if (!std::equal(buffer.get(),buffer.get()+n,buffer.get()+chunk))
+				return false;
+		}
 		return true;
 	}
 	
@@ -413,14 +472,20 @@ public:
 	
 	///Read from a FITS file
 	///\param path the path to the input file
-	bool read_fits(const std::string& path);
+	///\param storage the type in which to store the coefficients in memory
+	bool read_fits(const std::string& path,
+	               coefficient_storage storage=coefficient_storage::float32);
 	
 	///Read from a FITS 'file' in a memory buffer
 	///\param the input data buffer
 	///\param buffer_size the length of the input buffer
-	bool read_fits_mem(void* buffer, size_t buffer_size);
+	///\param storage the type in which to store the coefficients in memory
+	bool read_fits_mem(void* buffer, size_t buffer_size,
+	                   coefficient_storage storage=coefficient_storage::float32);
 	
 	///Write to a FITS file
+	///The coefficients are written in single precision, or in double
+	///precision if they are stored that way.
 	///\param path the path to the output file
 	void write_fits(const std::string& path) const;
 	
@@ -480,13 +545,62 @@ public:
 		const splinetable<Alloc>& table;
 		double (splinetable::*eval_ptr)(const int*, int, detail::buffer2d<float>) const;
 		void (splinetable::*v_eval_ptr)(const int*, const v4sf***, v4sf*) const;
+		void (splinetable::*n_eval_ptr)(const int*, const v4sf***, uint32_t, v4sf*) const;
+		///the instruction set variant of the gradient kernel in v_eval_ptr
+		simd_variant simd;
+		///the number of v4sf in each row of the basis passed to v_eval_ptr
+		uint32_t nvecs;
+		///the number of basis functions needed for the highest order dimension
+		uint32_t maxdegree;
+		///whether the bases of the dimensions are computed together in vector
+		///lanes, rather than one at a time
+		bool lane_basis;
+		///the reciprocals of the knot differences in each dimension, made by
+		///knot_reciprocals(), if the bases are computed without division, and
+		///otherwise empty
+		std::vector<std::vector<double>> reciprocals;
+		///center lookup for each dimension, which also holds plain copies of
+		///the dimension's order and knot count, and a plain pointer to its
+		///knots, so that evaluation need not go through the table's
+		///(possibly fancy) pointers
+		std::vector<detail::knot_search> search;
 		friend class splinetable<Alloc>;
 		evaluator(const splinetable<Alloc>& table):table(table){}
+		///Compute the basis functions for each dimension at a point, as
+		///ndsplineeval does
+		void fill_basis(const double* x, const int* centers, int derivatives,
+		                detail::buffer2d<float> localbasis) const;
 	public:
 		///\brief Get the underlying splinetable
 		const splinetable<Alloc>& get_table() const{ return(table); }
+		///\brief Get the instruction set variant selected for this evaluator
+		simd_variant get_simd_variant() const{ return(simd); }
 		///\brief same as splinetable::searchcenters
+		///
+		///In dimensions with many knots, the centers are computed directly if
+		///the knots are uniformly spaced, and otherwise a table is used to
+		///narrow the search.
 		bool searchcenters(const double* x, int* centers) const;
+		///\brief same as splinetable::huntcenters
+		bool huntcenters(const double* x, int* centers) const;
+		///\brief Check whether the knots in a dimension are uniformly spaced
+		bool has_uniform_knots(uint32_t dim) const{ return(search[dim].is_uniform); }
+		///\brief Compute the basis functions without division
+		///
+		///The basis functions are computed by multiplying by the reciprocals
+		///of the knot differences, found once here, rather than dividing by
+		///the differences. Bases computed together in vector lanes, whose
+		///divisions are already shared between dimensions, are unaffected.
+		///The results may then differ from those of the table in their last
+		///bits. This applies to ndsplineeval, operator(),
+		///ndsplineeval_gradient, ndsplineeval_batch, ndsplineeval_parallel,
+		///ndsplineeval_pipelined, basis_row, basis_rows, and cursors made from
+		///this evaluator. ndsplineeval_deriv, ndsplineeval_hessian and
+		///ndsplineeval_multi always divide, as the table does.
+		///\param enable whether to compute the basis functions without division
+		void use_knot_reciprocals(bool enable=true);
+		///\brief Check whether the basis functions are computed without division
+		bool uses_knot_reciprocals() const{ return(!reciprocals.empty()); }
 		///\brief same as splinetable::ndsplineeval
 		double ndsplineeval(const double* x, const int* centers, int derivatives=0) const;
 		///\brief Convenince short-cut for ndsplineeval
@@ -495,14 +609,484 @@ public:
 		void ndsplineeval_gradient(const double* x, const int* centers, double* evaluates) const;
 		///\brief same as splinetable::ndsplineeval_deriv
 		double ndsplineeval_deriv(const double* x, const int* centers, const unsigned int *derivatives) const;
+		///\brief same as splinetable::ndsplineeval_hessian
+		void ndsplineeval_hessian(const double* x, const int* centers, double* evaluates) const;
+		///\brief same as splinetable::ndsplineeval_multi
+		void ndsplineeval_multi(const double* x, const int* centers, const int* derivatives,
+		                        uint32_t nderivs, double* evaluates) const;
+		///\brief Evaluate the spline at many points
+		///
+		///For tables of one or two dimensions, points are processed in
+		///groups of PHOTOSPLINE_VECTOR_SIZE, with the basis function
+		///computations for a group done together, one point per lane. For
+		///more dimensions, in which evaluation is dominated by the
+		///coefficients and the lanes do not pay off, the points are
+		///evaluated one at a time. The results are identical to those of
+		///operator().
+		///\param coordinates an array of ndim pointers, the ith of which
+		///       points to the npoints coordinates of the points in dimension i
+		///\param npoints the number of points to evaluate
+		///\param results an array of length npoints which will be populated
+		///       with the spline values, or zero for points outside the table
+		///\param derivatives a bitmask indicating in which dimensions the spline
+		///       should be differentiated, as for ndsplineeval
+		void ndsplineeval_batch(const double* const* coordinates, size_t npoints,
+		                        double* results, int derivatives=0) const;
+		///\brief Evaluate the spline at many points using several threads
+		///
+		///The points are divided into chunks, which the threads claim one at
+		///a time until none remain, so that the work stays balanced even
+		///when some points (such as those outside the table) are much
+		///cheaper than others. The calling thread takes part. The results
+		///are identical to those of ndsplineeval_batch, whatever the number
+		///of threads.
+		///\param coordinates an array of ndim pointers, the ith of which
+		///       points to the npoints coordinates of the points in dimension i
+		///\param npoints the number of points to evaluate
+		///\param results an array of length npoints which will be populated
+		///       with the spline values, or zero for points outside the table
+		///\param derivatives a bitmask indicating in which dimensions the spline
+		///       should be differentiated, as for ndsplineeval
+		///\param nthreads the maximum number of threads to use, or zero to
+		///       use one per hardware thread
+		void ndsplineeval_parallel(const double* const* coordinates, size_t npoints,
+		                           double* results, int derivatives=0,
+		                           unsigned int nthreads=0) const;
+		///\brief Evaluate the spline at many points scattered through a table
+		///       too large to stay in cache
+		///
+		///Evaluation at scattered points in a large table spends most of
+		///its time waiting for coefficients to arrive from main memory. This
+		///finds the centers and basis functions for a small window of points
+		///and requests the coefficients which support them, then evaluates
+		///the previous window, whose coefficients have meanwhile arrived, so
+		///that the waits for several points overlap. The results are
+		///identical to those of operator().
+		///\param coordinates an array of ndim pointers, the ith of which
+		///       points to the npoints coordinates of the points in dimension i
+		///\param npoints the number of points to evaluate
+		///\param results an array of length npoints which will be populated
+		///       with the spline values, or zero for points outside the table
+		///\param derivatives a bitmask indicating in which dimensions the spline
+		///       should be differentiated, as for ndsplineeval
+		///\param reorder whether to evaluate the points sorted by their cells
+		///       in Morton order, so that points which share coefficients
+		///       are evaluated together. The results are still written in the
+		///       original order. This costs a sort, so pays off when there
+		///       are many points which are not already ordered.
+		void ndsplineeval_pipelined(const double* const* coordinates, size_t npoints,
+		                            double* results, int derivatives=0,
+		                            bool reorder=false) const;
+		
+		///\brief Get the number of tensor-product basis functions which are
+		///       non-zero at a point in the table: the product over all
+		///       dimensions of order+1
+		uint64_t basis_row_size() const;
+		///\brief Get the tensor-product basis functions which are non-zero
+		///       at a point, with the indices of the coefficients they weight
+		///
+		///The value of the spline at x is the sum of weights[i] times the
+		///coefficient with flat index indices[i], so these form the row for
+		///x of the matrix which maps coefficients to values, as needed to
+		///fit in the space of the coefficients. The indices are those of the
+		///coefficients in row-major order, whatever their storage, and
+		///increase along the row.
+		///\param x a vector of coordinates
+		///\param centers the centers of x, found with searchcenters
+		///\param indices an array of length basis_row_size() which will be
+		///       populated with the flat indices of the coefficients
+		///\param weights an array of length basis_row_size() which will be
+		///       populated with the basis function products
+		///\param derivatives a bitmask indicating in which dimensions the
+		///       basis functions should be differentiated, as for ndsplineeval
+		void basis_row(const double* x, const int* centers, uint64_t* indices,
+		               double* weights, int derivatives=0) const;
+		///\brief Get the non-zero basis functions at many points, as the rows
+		///       of a matrix in compressed sparse row (CSR) form
+		///
+		///The entries of the row for point p are columns[k] and values[k]
+		///for k from rowStarts[p] to rowStarts[p+1], as written by
+		///basis_row; points outside the table have empty rows.
+		///\param coordinates an array of ndim pointers, the ith of which
+		///       points to the npoints coordinates of the points in dimension i
+		///\param npoints the number of points
+		///\param rowStarts an array of length npoints+1 which will be
+		///       populated with the offset of each row's first entry, followed
+		///       by the total number of entries
+		///\param columns an array of length npoints*basis_row_size() which
+		///       will be populated with the flat coefficient indices
+		///\param values an array of length npoints*basis_row_size() which will
+		///       be populated with the basis function products
+		///\param derivatives a bitmask indicating in which dimensions the
+		///       basis functions should be differentiated, as for ndsplineeval
+		void basis_rows(const double* const* coordinates, size_t npoints, uint64_t* rowStarts,
+		                uint64_t* columns, double* values, int derivatives=0) const;
+		
+		///\brief Evaluates the spline repeatedly at points which differ in
+		///       only some of their coordinates
+		///
+		///A cursor keeps the center and basis functions for each dimension
+		///of the current point, and recomputes them only for the coordinates
+		///which change. It also keeps the products of the basis functions of
+		///the leading dimensions (all but the last), recomputing only those
+		///which involve a changed dimension, so scans along the last
+		///dimension are cheapest. The results are identical to those of
+		///evaluator::operator(), except that if the evaluator uses knot
+		///reciprocals the cursor computes every basis without division,
+		///including those which operator() computes in vector lanes.
+		///
+		///The cursor holds a reference to the evaluator from which it was
+		///constructed, so it is invalidated with it.
+		struct cursor{
+		private:
+			const evaluator& eval;
+			///the bitmask of dimensions in which the spline is differentiated
+			int derivatives;
+			///the number of basis functions stored for each dimension
+			uint32_t maxdegree;
+			std::vector<double> coordinates;
+			std::vector<int> centers;
+			///whether each coordinate has been set and is within the table
+			std::vector<bool> inside;
+			///the basis functions for each dimension, maxdegree per dimension
+			std::vector<float> localbasis;
+			///for each number j of leading dimensions, the product of their
+			///basis functions for each combination of those which are
+			///supported, with the later dimensions varying fastest
+			std::vector<std::vector<float>> products;
+			///the positions in storage of the coefficients corresponding to
+			///the combinations in products
+			std::vector<std::vector<uint64_t>> positions;
+			///the first leading dimension whose products are out of date
+			uint32_t stale;
+			
+			void update_products();
+			template<typename Coeff>
+			double accumulate() const;
+		public:
+			///\param eval the evaluator to use
+			///\param derivatives a bitmask indicating in which dimensions the
+			///       spline should be differentiated, as for ndsplineeval
+			explicit cursor(const evaluator& eval, int derivatives=0);
+			///\brief Move one coordinate of the current point
+			///\return false if the coordinate is outside the table
+			bool set_coordinate(uint32_t dim, double x);
+			///\brief Move to a new point, recomputing only what depends on
+			///       the coordinates which have changed
+			///\return false if the point is outside the table
+			bool set_coordinates(const double* x);
+			///\brief Evaluate the spline at the current point
+			///\return the spline value, or zero if any coordinate is unset or
+			///        outside the table
+			double evaluate();
+			///\brief Convenience short-cut for set_coordinates and evaluate
+			double operator()(const double* x){
+				set_coordinates(x);
+				return(evaluate());
+			}
+		};
 	};
 	friend struct evaluator;
 	
+	///\brief Evaluates several tables which share the same knots at once
+	///
+	///Families of tables often have identical knots and orders, differing
+	///only in their coefficients. A table_group finds the centers and
+	///computes the basis functions for a point once for all of its tables,
+	///and then contracts them with the coefficients of each table. The
+	///coefficients are copied into the group interleaved, so that those of
+	///all of the tables for each basis function are adjacent in memory.
+	///Those of tables stored in double precision are kept in double
+	///precision, apart from the others, and those of all other tables in
+	///single precision, so that each table evaluates as it does alone.
+	///
+	///The group uses the knots of the first of its tables, so it must be
+	///considered invalidated if that table is altered or destroyed. The
+	///other tables are no longer needed once the group is constructed.
+	struct table_group{
+	private:
+		///used for its center lookup
+		evaluator eval;
+		///the number of tables
+		uint32_t ntables;
+		///for each table, whether its coefficients are in wide_coefficients
+		///rather than coefficients, and its position among those there
+		std::vector<bool> wide;
+		std::vector<uint32_t> slots;
+		///the number of tables in coefficients and in wide_coefficients
+		uint32_t nnarrow, nwide;
+		///the coefficients of the tables stored in single or lower
+		///precision, in the standard order but with the nnarrow
+		///coefficients for each basis function together
+		std::vector<float> coefficients;
+		///the same for the tables stored in double precision
+		std::vector<double> wide_coefficients;
+	public:
+		///\param tables the tables to evaluate, which must all have the same
+		///       dimension, orders, and knots, but may store their
+		///       coefficients in any layout or type
+		///\throws std::runtime_error if the tables are not compatible
+		explicit table_group(const std::vector<const splinetable<Alloc>*>& tables);
+		///\brief Get the table whose knots are used
+		const splinetable<Alloc>& get_table() const{ return(eval.get_table()); }
+		///\brief Get the number of tables in the group
+		uint32_t size() const{ return(ntables); }
+		///\brief same as splinetable::searchcenters
+		bool searchcenters(const double* x, int* centers) const{ return(eval.searchcenters(x, centers)); }
+		///\brief same as evaluator::use_knot_reciprocals, for ndsplineeval
+		///       and operator()
+		void use_knot_reciprocals(bool enable=true){ eval.use_knot_reciprocals(enable); }
+		///\brief Check whether the basis functions are computed without division
+		bool uses_knot_reciprocals() const{ return(eval.uses_knot_reciprocals()); }
+		///\brief Evaluate all of the tables at once
+		///\param x a vector of coordinates at which the tables are to be evaluated
+		///\param centers a vector of knot indices derived from x, constructed
+		///       using searchcenters
+		///\param results an array of length size() which will be populated
+		///       with the value of each table, in the order in which they were
+		///       given to the constructor
+		///\param derivatives a bitmask indicating in which dimensions the
+		///       tables should be differentiated, as for ndsplineeval
+		void ndsplineeval(const double* x, const int* centers, double* results, int derivatives=0) const;
+		///\brief Convenience short-cut for ndsplineeval, which yields zeros
+		///       if center lookup fails
+		void operator()(const double* x, double* results, int derivatives=0) const;
+	};
+	
+	///\brief Evaluates the spline as a piecewise polynomial
+	///
+	///Within each cell of the grid of knots the spline is a polynomial,
+	///of degree order[i] in coordinate i. This computes the coefficients of
+	///all of those polynomials, in powers of the position within the cell
+	///scaled to [0,1], so that evaluation needs only a lookup of the cell and
+	///a nested Horner scheme, with no basis function recursion or division.
+	///The price is memory: each cell needs as many coefficients as there are
+	///B-splines which are non-zero in it, which for a table with many knots
+	///is about the product of order[i]+1 times as many as the table has,
+	///stored in double precision. This suits small tables which are
+	///evaluated very many times; compare() reports the trade for a table.
+	///
+	///The results agree with those of the evaluator to within rounding.
+	///The polynomial_evaluator holds a reference to the table from which it
+	///was constructed, which is used only by compare().
+	struct polynomial_evaluator{
+	private:
+		const splinetable<Alloc>& table;
+		uint32_t ndim;
+		std::vector<uint32_t> order;
+		///the knots in each dimension, the first of each pair bounding a cell
+		std::vector<std::vector<double>> knots;
+		///for each dimension, the reciprocal of the width of each cell
+		std::vector<std::vector<double>> scales;
+		///the number of cells in each dimension
+		std::vector<uint64_t> ncells;
+		///the number of coefficients of the polynomial in each cell
+		uint64_t cellsize;
+		///the coefficients of the polynomial in each cell, with the cells in
+		///row-major order, and the powers of the last dimension varying
+		///fastest within each cell
+		std::vector<double> coefficients;
+	public:
+		///\brief The memory needed by, and speed of, a table's evaluator
+		///       and its polynomial_evaluator
+		struct tradeoff{
+			size_t table_bytes; ///< the memory used by the table's coefficients
+			size_t polynomial_bytes; ///< the memory used by the polynomials
+			double table_eval_rate; ///< evaluations per second with the evaluator
+			double polynomial_eval_rate; ///< evaluations per second as polynomials
+		};
+		
+		explicit polynomial_evaluator(const splinetable<Alloc>& table);
+		///\brief Find the cells containing a point
+		///\param x a vector of coordinates
+		///\param cells a vector of cell indices, one for each dimension, which
+		///       will be filled in
+		///\return false if the point is outside the table
+		bool searchcells(const double* x, int* cells) const;
+		///\brief Evaluate the spline, or its derivatives, at a point
+		///\param x a vector of coordinates at which the spline is to be evaluated
+		///\param cells the cells containing x, found with searchcells
+		///\param derivatives a bitmask indicating in which dimensions the spline
+		///       should be differentiated, as for splinetable::ndsplineeval
+		double ndsplineeval(const double* x, const int* cells, int derivatives=0) const;
+		///\brief Convenience short-cut for ndsplineeval, which yields zero if
+		///       the point is outside the table
+		double operator()(const double* x, int derivatives=0) const;
+		///\brief Get the memory used by the polynomial coefficients, in bytes
+		size_t memory_usage() const{ return(coefficients.size()*sizeof(double)); }
+		///\brief Measure the memory and speed of this form against those of
+		///       the table's evaluator, at randomly chosen points
+		///\param trialCount the number of points at which to time each
+		tradeoff compare(size_t trialCount=100000) const;
+	};
+	
+	///\brief Evaluates the spline from a low-rank tensor-train approximation
+	///       of its coefficients
+	///
+	///The coefficient tensor is approximated by a product of one core per
+	///dimension, the core of dimension i holding for each of its coefficient
+	///indices a matrix of size rank(i) by rank(i+1), with rank(0) and
+	///rank(ndim) being one. The cores are found by successive truncated
+	///singular value decompositions of unfoldings of the tensor (TT-SVD),
+	///discarding as many singular values as the tolerance allows, so the
+	///ranks adapt to how smooth the coefficients are between dimensions.
+	///Evaluation contracts the local basis of each dimension with the
+	///supporting matrices of its core in turn, and never forms the full
+	///tensor, taking about the sum over dimensions of
+	///(order[i]+1)*rank(i)*rank(i+1) operations rather than the product of
+	///order[i]+1.
+	///
+	///The tolerance bounds the root-sum-square change to the coefficients.
+	///Since the basis functions are non-negative and sum to at most one,
+	///this also bounds the change to any value of the spline, although not
+	///to its derivatives. The cores are stored in single precision.
+	///
+	///Like a table_group, a tensor_train uses the knots of its table, so it
+	///must be considered invalidated if that table is altered or destroyed.
+	struct tensor_train{
+	private:
+		///used for its center lookup
+		evaluator eval;
+		uint32_t ndim;
+		///the ranks between the dimensions, ndim+1 of them
+		std::vector<uint32_t> ranks;
+		///the largest of ranks
+		uint32_t maxrank;
+		///the largest order plus one
+		uint32_t maxdegree;
+		///the core of each dimension, with the matrix for each coefficient
+		///index stored contiguously in row-major order
+		std::vector<std::vector<float>> cores;
+		///the root-sum-square of the discarded singular values
+		double error;
+	public:
+		///\param table the table whose coefficients are to be approximated
+		///\param tolerance the largest allowed root-sum-square change to the
+		///       coefficients; zero keeps all singular values which can be
+		///       told apart from rounding, so that the change may be of order
+		///       1e-8 times the root-sum-square of the coefficients
+		///\param maxRank the largest rank to keep between any two
+		///       dimensions, which takes precedence over tolerance
+		///\throws std::runtime_error if tolerance is negative or maxRank is zero
+		tensor_train(const splinetable<Alloc>& table, double tolerance,
+		             uint32_t maxRank=std::numeric_limits<uint32_t>::max());
+		///\brief Get the table whose knots are used
+		const splinetable<Alloc>& get_table() const{ return(eval.get_table()); }
+		///\brief same as splinetable::searchcenters
+		bool searchcenters(const double* x, int* centers) const{ return(eval.searchcenters(x, centers)); }
+		///\brief Evaluate the approximated spline, or its derivatives, at a point
+		///\param x a vector of coordinates at which the spline is to be evaluated
+		///\param centers a vector of knot indices derived from x, constructed
+		///       using searchcenters
+		///\param derivatives a bitmask indicating in which dimensions the spline
+		///       should be differentiated, as for splinetable::ndsplineeval
+		double ndsplineeval(const double* x, const int* centers, int derivatives=0) const;
+		///\brief Convenience short-cut for ndsplineeval, which yields zero if
+		///       center lookup fails
+		double operator()(const double* x, int derivatives=0) const;
+		///\brief Get the rank between dimensions dim-1 and dim, which is one
+		///       for dim 0 and ndim
+		uint32_t get_rank(uint32_t dim) const{ return(ranks.at(dim)); }
+		///\brief Get the memory used by the cores, in bytes
+		size_t memory_usage() const;
+		///\brief Get the root-sum-square change to the coefficients made by
+		///       the approximation, apart from rounding
+		double error_bound() const{ return(error); }
+	};
+	
+	///\brief An evaluator for tables whose shape is known at compile time
+	///
+	///The number of dimensions and the order in each are given by Orders, so
+	///that evaluation calls the kernel specialized for them directly rather
+	///than through a function pointer, with the loops over dimensions and
+	///over the supporting coefficients of fixed length, and the space for
+	///the basis functions fixed in size. Code which knows the shape of its
+	///tables can therefore have evaluation inlined into it entirely.
+	///
+	///The shape is checked against the table when the static_evaluator is
+	///constructed, which also requires that the coefficients be untiled
+	///floats. Like the evaluator, it holds a reference to the table from
+	///which it was obtained, and must be considered invalidated if that
+	///table is altered or destroyed.
+	template<unsigned int ... Orders>
+	struct static_evaluator{
+		static_assert(sizeof...(Orders) > 0, "A spline must have at least one dimension");
+		///the number of dimensions
+		static constexpr unsigned int D = sizeof...(Orders);
+		///the number of basis functions needed for the highest order dimension
+		static constexpr unsigned int maxdegree = detail::max_order<Orders...>() + 1;
+	private:
+		const splinetable<Alloc>& table;
+		///center lookup for each dimension, which also holds a plain pointer
+		///to its knots
+		std::vector<detail::knot_search> search;
+	public:
+		///\throws std::runtime_error if the table does not have the shape
+		///        given by Orders, or its coefficients are not untiled floats
+		explicit static_evaluator(const splinetable<Alloc>& table);
+		///\brief Get the underlying splinetable
+		const splinetable<Alloc>& get_table() const{ return(table); }
+		///\brief Acquire a centers vector for use with ndsplineeval, as
+		///       evaluator::searchcenters
+		bool searchcenters(const double* x, int* centers) const{
+			for (unsigned int n = 0; n < D; n++) {
+				if (!search[n].find(x[n], centers[n]))
+					return(false);
+			}
+			return(true);
+		}
+		///\brief Evaluate the spline, or its derivatives, at a point, as
+		///       evaluator::ndsplineeval
+		double ndsplineeval(const double* x, const int* centers, int derivatives=0) const;
+		///\brief Convenience short-cut for ndsplineeval, which yields zero if
+		///       the point is outside the table
+		double operator()(const double* x, int derivatives=0) const{
+			int centers[D];
+			if (!searchcenters(x, centers))
+				return(0);
+			return(ndsplineeval(x, centers, derivatives));
+		}
+	};
+	
 	///Constructs an optimized evaluator object which will use the best
 	///available internal routines to perform evaulations. The evaluator holds
 	///a reference to this splinetable, so it must be considered invalidated if
 	///this table altered or destroyed.
+	///
+	///The best instruction set variant which the CPU supports is chosen
+	///automatically.
 	evaluator get_evaluator() const;
+	///Constructs an optimized evaluator object, as get_evaluator(), but
+	///using no instruction set variant beyond the one given (or the one for
+	///which the library was compiled, if that is wider).
+	///\param variant the widest variant to allow; if the CPU does not
+	///       support this variant the best one it does support is used instead
+	evaluator get_evaluator(simd_variant variant) const;
+	///Constructs an evaluator for this table specialized at compile time for
+	///its shape, which must be exactly Orders, for example
+	///  auto eval = table.get_static_evaluator<2,2,3>();
+	///for a three dimensional table with orders 2, 2, and 3.
+	///\throws std::runtime_error if the table does not have this shape, or
+	///        its coefficients are not untiled floats
+	template<unsigned int ... Orders>
+	static_evaluator<Orders...> get_static_evaluator() const{
+		return(static_evaluator<Orders...>(*this));
+	}
+	
+	///Register evaluation kernels specialized for tables whose orders in
+	///each dimension are exactly Orders, for use by evaluators obtained
+	///afterwards. Kernels for tables of uniform order, over the range of
+	///dimensions and orders given by PHOTOSPLINE_EVAL_MAX_DIM,
+	///PHOTOSPLINE_EVAL_MIN_ORDER, and PHOTOSPLINE_EVAL_MAX_ORDER, are built
+	///in; tables with mixed orders otherwise use kernels which know only
+	///their dimension. Calling this from an application, for example as
+	///  photospline::splinetable<>::register_evaluation_kernels<2,2,2,3,2,2>();
+	///compiles the kernels in the application's own translation unit, so
+	///that the library need not anticipate every combination of orders.
+	///\return true if the kernels were newly registered, false if kernels
+	///        for these orders were already registered
+	template<unsigned int ... Orders>
+	static bool register_evaluation_kernels();
 	
 	/*
 	 * Spline table based hypersurface evaluation. ndsplineeval() takes a spline
@@ -521,6 +1105,20 @@ public:
 	///\return whether centers was sucessfully populated
 	///\pre x and centers must both have lengths matching the spline's dimension
 	bool searchcenters(const double* x, int* centers) const;
+	///Acquire a centers vector for use with the ndsplineeval functions,
+	///starting from the centers of a previous point.
+	///This gives the same result as searchcenters, but instead of searching
+	///all of the knots it walks outward from the previous centers, so it is
+	///much faster when evaluating a sequence of nearby points, such as along
+	///a track.
+	///\param x a vector of coordinates at which the spline is to be evaluated
+	///\param centers a vector of indices which should contain the centers
+	///       found for the previous point, and which will be populated by this
+	///       function. Any indices which are not valid centers are ignored, so
+	///       that the same vector may be reused after a failed lookup.
+	///\return whether centers was sucessfully populated
+	///\pre x and centers must both have lengths matching the spline's dimension
+	bool huntcenters(const double* x, int* centers) const;
 	
 	///Evaluate the spline hypersurface.
 	///\param x a vector of coordinates at which the spline is to be evaluated
@@ -561,6 +1159,39 @@ public:
 	///\pre evaluates must have a length one greater than the dimension of the spline
 	void ndsplineeval_gradient(const double* x, const int* centers, double* evaluates) const;
 	
+	///Evaluate the spline hypersurface, its gradient, and its Hessian.
+	///All of these are accumulated in a single pass over the coefficients
+	///which support x, so this is much cheaper than obtaining the second
+	///derivatives from repeated calls to ndsplineeval_deriv.
+	///\param x a vector of coordinates at which the spline is to be evaluated
+	///\param centers a vector of knot indices derived from x, constructed using
+	///       searchcenters
+	///\param evaluates a vector which will be populated by this function with
+	///       the spline value, followed by the components of the gradient,
+	///       followed by the upper triangle of the Hessian in row-major order
+	///       (d2/dx0dx0, d2/dx0dx1, ..., d2/dx0dxN, d2/dx1dx1, ...).
+	///\pre evaluates must have a length of at least hessian_size()
+	void ndsplineeval_hessian(const double* x, const int* centers, double* evaluates) const;
+	///Get the number of quantities computed by ndsplineeval_hessian
+	uint32_t hessian_size() const{ return(1 + ndim + ndim*(ndim+1)/2); }
+	
+	///Evaluate several derivatives of the spline hypersurface at once.
+	///All of the requested quantities are accumulated in a single pass over
+	///the coefficients which support x, so when only a few of them are
+	///needed this is cheaper than ndsplineeval_gradient or separate calls
+	///to ndsplineeval.
+	///\param x a vector of coordinates at which the spline is to be evaluated
+	///\param centers a vector of knot indices derived from x, constructed using
+	///       searchcenters
+	///\param derivatives a vector of bitmasks, each indicating in which
+	///       dimensions the spline should be differentiated, as for
+	///       ndsplineeval. A mask of zero requests the value.
+	///\param nderivs the number of masks in derivatives
+	///\param evaluates a vector which will be populated by this function
+	///       with the result for each mask, in the same order
+	void ndsplineeval_multi(const double* x, const int* centers, const int* derivatives,
+	                        uint32_t nderivs, double* evaluates) const;
+	
 	///A container for results obtained from benchmark_evaluation
 	struct benchmark_results{
 		///The rate at which ndsplineeval can evaluate the value of the spline
@@ -572,6 +1203,9 @@ public:
 		///The rate at which ndsplineeval_gradient can evaluate the value and
 		///gradient of the spline
 		double gradient_multi_eval_rate;
+		///The rate at which evaluator::ndsplineeval_batch can evaluate the
+		///value of the spline
+		double batch_eval_rate;
 	};
 	///Evaluate the spline at random points within the extent
 	///\param trialCountthe number of times each type of evaluation should be
@@ -640,19 +1274,98 @@ public:
 		return(naxes[dim]);
 	}
 	///Get the stride through the coefficient array corresponding to a given dimension
+	///\note This is the stride in the standard layout, which does not apply
+	///      while the coefficients are tiled
 	uint64_t get_stride(uint32_t dim) const{
 		assert(dim<ndim);
 		return(strides[dim]);
 	}
 	///Raw access to the coefficients. Use with care.
+	///\throws std::runtime_error if the coefficients are tiled or not stored
+	///        as float, since they are then not an array in the standard
+	///        layout; see untile_coefficients and set_coefficient_storage
 	float* get_coefficients(){
+		if(storage!=coefficient_storage::float32)
+			throw std::runtime_error("Coefficients are stored as "+std::string(coefficient_storage_name(storage))+", not float");
+		require_standard_coefficients("Raw access to the coefficients");
 		return(&coefficients[0]);
 	}
 	///Raw access to the coefficients.
+	///\throws std::runtime_error if the coefficients are tiled or not stored
+	///        as float, since they are then not an array in the standard
+	///        layout; see untile_coefficients and set_coefficient_storage
 	const float* get_coefficients() const{
+		if(storage!=coefficient_storage::float32)
+			throw std::runtime_error("Coefficients are stored as "+std::string(coefficient_storage_name(storage))+", not float");
+		require_standard_coefficients("Raw access to the coefficients");
 		return(&coefficients[0]);
 	}
 	
+	///Get the type in which the coefficients are stored in memory
+	coefficient_storage get_coefficient_storage() const{ return(storage); }
+	///Convert the coefficients to be stored in memory as a different type.
+	///Storing them in half precision halves the memory needed, and the
+	///memory traffic of evaluation, at the cost of rounding the coefficients
+	///to 11 (float16) or 8 (bfloat16) significant bits. During evaluation
+	///they are converted back to float. Storing them in double precision
+	///avoids rounding them, for studies of precision, and evaluation then
+	///sums the value (though not the gradient) in double precision.
+	///Evaluators obtained before the conversion must be considered
+	///invalidated. Like tiling, storage other than float makes convolve,
+	///permuteDimensions, grideval, and stacking unavailable.
+	///\param storage the type in which to store the coefficients. Quantized
+	///       types cannot be chosen here; use quantize_coefficients.
+	void set_coefficient_storage(coefficient_storage storage);
+	///Compress the coefficients by quantizing them to 8 or 16 bit integers.
+	///The coefficients are tiled as by tile_coefficients, and each tile is
+	///quantized separately, with its own scale and offset spanning the range
+	///of its coefficients, so that tiles of small coefficients keep their
+	///precision. This reduces the memory needed by nearly 4 (int8) or 2
+	///(int16) times. The coefficients are decoded to float during evaluation.
+	///
+	///Since the basis functions are non-negative and sum to at most one,
+	///no value of the spline changes by more than the largest change to any
+	///coefficient, which is returned. Derivatives are not bounded this way,
+	///and may change by more.
+	///
+	///The quantized coefficients cannot be retiled. They can be decoded with
+	///set_coefficient_storage, but the rounding is not undone.
+	///\param storage coefficient_storage::int8 or coefficient_storage::int16
+	///\param tileSize the number of coefficients along each dimension of a
+	///       tile, as for tile_coefficients
+	///\return the largest absolute change to any coefficient
+	double quantize_coefficients(coefficient_storage storage, uint32_t tileSize=4);
+	
+	///Rearrange the coefficients in memory into tiles.
+	///Evaluation at a point uses a block of order+1 coefficients along each
+	///dimension. In the standard row-major layout the rows of this block lie
+	///far apart in a large table, so that each evaluation touches many cache
+	///lines and pages. Storing the coefficients in contiguous tiles, each
+	///covering a few coefficients along every dimension, confines the block
+	///to a few tiles. Evaluators obtained afterwards use kernels for the
+	///tiled layout; existing evaluators must be considered invalidated.
+	///
+	///Only the arrangement in memory changes: evaluation gives identical
+	///results, and write_fits still writes the standard layout. While the
+	///coefficients are tiled, convolve, permuteDimensions, grideval, and
+	///stacking are unavailable.
+	///\param tileSize the number of coefficients along each dimension of a
+	///       tile. The tiles are made a little larger where that avoids
+	///       padding, and are no larger than the table.
+	///\throws std::runtime_error if the coefficients are quantized
+	void tile_coefficients(uint32_t tileSize=4);
+	///Restore the standard row-major layout of the coefficients
+	///\throws std::runtime_error if the coefficients are quantized
+	void untile_coefficients();
+	///Check whether the coefficients are stored in tiles
+	bool is_tiled() const{ return(tile_extents!=NULL); }
+	///Get the number of coefficients along a given dimension of each tile
+	///\return the tile extent, or zero if the coefficients are not tiled
+	uint32_t get_tile_extent(uint32_t dim) const{
+		assert(dim<ndim);
+		return(tile_extents ? tile_extents[dim] : 0);
+	}
+
 #ifdef PHOTOSPLINE_INCLUDES_SPGLAM
 	
 	///constant used to specify that no dimension should be forced to be
@@ -698,6 +1411,26 @@ public:
 	
 #endif //PHOTOSPLINE_INCLUDES_SPGLAM
 	
+	///Evaluate the spline on a dense grid
+	///
+	///The non-zero basis functions are computed once for each coordinate
+	///along each axis, and the coefficients are contracted with them one
+	///dimension at a time, in double precision. This needs far less work
+	///than evaluating each grid point separately, and unlike grideval
+	///does not need SuiteSparse. The results agree with those of
+	///ndsplineeval to within the rounding of its single precision sums.
+	///\param coords a set of arrays specifying the evaluation points in each
+	///            dimension
+	///\param results an array which will be populated with the spline values
+	///       at every combination of the coordinates, in row-major order
+	///       (the last dimension varying fastest), or zero for points outside
+	///       the table. Its length must be the product of the numbers of
+	///       coordinates in each dimension.
+	///\param derivatives a bitmask indicating in which dimensions the spline
+	///       should be differentiated, as for ndsplineeval
+	template<typename DoubleContCont>
+	void grideval_dense(const DoubleContCont& coords, double* results, int derivatives=0) const;
+	
 	///Draw a number of random samples from the distribution given by a slice
 	///through the spline.
 	///\tparam N the number of dimensions in which to sample
@@ -767,6 +1500,25 @@ private:
 	uint64_t_ptr naxes;
 	uint64_t_ptr strides;
 	
+	//Coefficients stored other than as float are kept, in the type given by
+	//storage, in packed_coefficients rather than coefficients.
+	coefficient_storage storage;
+	char_ptr packed_coefficients;
+	//For quantized coefficients, the scale and offset of each tile,
+	//interleaved. The offsets of the coefficients hold the index of their
+	//tile above their lowest block_shift bits, and their position in
+	//storage in those bits, so that summing them yields both.
+	float_ptr block_parameters;
+	uint32_t block_shift;
+	
+	//The tiled layout, if any. The position of a coefficient in storage is
+	//the sum over dimensions of coefficient_offsets[i][j], where j is its
+	//index in dimension i, just as it is the sum of j*strides[i] in the
+	//standard layout. Offsets are also kept for coefficients not stored as
+	//float when they are not tiled, so that the same kernels apply.
+	uint32_t_ptr tile_extents;
+	uint64_t_ptr_ptr coefficient_offsets;
+	
 	uint32_t naux;
 	char_ptr_ptr_ptr aux;
 	
@@ -791,6 +1543,9 @@ private:
 	double ndsplineeval_coreD_FixedOrder(const int* centers, int maxdegree, detail::buffer2d<float> localbasis) const;
 	template<unsigned int ... Orders>
 	double ndsplineeval_core_KnownOrder(const int* centers, int maxdegree, detail::buffer2d<float> localbasis) const;
+	template<unsigned int D, unsigned int O, typename Coeff>
+	double ndsplineeval_core_offsets(const int* centers, int maxdegree, detail::buffer2d<float> localbasis) const;
+	double ndsplineeval_core_stored(const int* centers, int maxdegree, detail::buffer2d<float> localbasis) const;
 	
 	void ndsplineeval_multibasis_core(const int *centers, const v4sf*** localbasis, v4sf* result) const;
 	template<unsigned int D>
@@ -799,7 +1554,104 @@ private:
 	void ndsplineeval_multibasis_coreD_FixedOrder(const int *centers, const v4sf*** localbasis, v4sf* result) const;
 	template<unsigned int ... Orders>
 	void ndsplineeval_multibasis_core_KnownOrder(const int *centers, const v4sf*** localbasis, v4sf* result) const;
+	template<unsigned int D, unsigned int O, typename Coeff>
+	void ndsplineeval_multibasis_core_offsets(const int *centers, const v4sf*** localbasis, v4sf* result) const;
+	void ndsplineeval_multibasis_core_stored(const int *centers, const v4sf*** localbasis, v4sf* result) const;
+	/*
+	 * Accumulation for ndsplineeval_hessian and ndsplineeval_multi, where
+	 * each row of the basis has a number of vectors which depends on the
+	 * quantities requested.
+	 */
+	template<unsigned int O, typename Coeff>
+	void ndsplineeval_multibasis_core_n(const int *centers, const v4sf*** localbasis, uint32_t nvecs, v4sf* result) const;
+	typedef void (splinetable::*multibasis_n_kernel)(const int*, const v4sf***, uint32_t, v4sf*) const;
+	///Select the ndsplineeval_multibasis_core_n kernel for the coefficient
+	///storage and an order common to all dimensions, or zero if there is none
+	multibasis_n_kernel select_multibasis_n_kernel(uint32_t constOrder) const;
+	///The bodies of ndsplineeval_hessian and ndsplineeval_multi, which read
+	///the knots from an evaluator's snapshot of them if search is not NULL
+	void evaluate_hessian(const double* x, const int* centers, double* evaluates, multibasis_n_kernel kernel,
+	                      const detail::knot_search* search) const;
+	void evaluate_multi(const double* x, const int* centers, const int* derivatives, uint32_t nderivs,
+	                    double* evaluates, multibasis_n_kernel kernel, const detail::knot_search* search) const;
+	template<unsigned int D, unsigned int O, typename Coeff>
+	static void select_offset_kernels(evaluator& eval, uint32_t constOrder, std::true_type /*more orders*/);
+	template<unsigned int D, unsigned int O, typename Coeff>
+	static void select_offset_kernels(evaluator& eval, uint32_t constOrder, std::false_type /*no more*/);
+	template<unsigned int D>
+	static void select_storage_kernels(evaluator& eval, uint32_t constOrder, coefficient_storage storage);
+	template<unsigned int D>
+	static void select_storage_kernels(evaluator& eval, uint32_t constOrder, std::true_type /*more dimensions*/);
+	template<unsigned int D>
+	static void select_storage_kernels(evaluator& eval, uint32_t constOrder, std::false_type /*no more*/);
+	
+	///The position in storage of the coefficient with the given index along
+	///one dimension, relative to the start of the row which contains it.
+	///The position of any coefficient is the sum of these for its indices.
+	uint64_t coefficient_position(uint32_t dim, uint64_t index) const{
+		return(coefficient_offsets ? coefficient_offsets[dim][index] : index*strides[dim]);
+	}
+	///The positions of count consecutive coefficients along one dimension,
+	///starting from the given index, read through plain pointers
+	void coefficient_positions(uint32_t dim, uint64_t first, uint32_t count, uint64_t* positions) const{
+		if (coefficient_offsets) {
+			const uint64_t* offsets = &coefficient_offsets[dim][first];
+			std::copy_n(offsets, count, positions);
+		} else {
+			const uint64_t stride = strides[dim];
+			for (uint32_t i = 0; i < count; i++)
+				positions[i] = (first + i)*stride;
+		}
+	}
+	///Start loading into cache the coefficients which support the point
+	///with the given centers, without waiting for them
+	void prefetch_support(const int* centers) const;
+	template<typename Coeff>
+	void prefetch_support(const int* centers) const;
+	///The number of v4sf in each row of the basis for gradient evaluation
+	///with vectors of the given number of lanes. The rows hold the value and
+	///each component of the gradient, padded to fill whole vectors.
+	uint32_t gradient_nvecs(uint32_t width) const{
+		return((ndim + width)/width*width/PHOTOSPLINE_VECTOR_SIZE);
+	}
 	
+	typedef void (splinetable::*multibasis_kernel)(const int*, const v4sf***, v4sf*) const;
+	typedef double (splinetable::*eval_kernel)(const int*, int, detail::buffer2d<float>) const;
+	///A pair of kernels for evaluating values and gradients
+	struct kernel_pair{
+		eval_kernel eval;
+		multibasis_kernel v_eval;
+	};
+	///Kernels registered for particular combinations of orders
+	struct kernel_registry{
+		std::mutex mutex;
+		std::map<std::vector<uint32_t>,kernel_pair> kernels;
+	};
+	static kernel_registry& registered_kernels();
+	template<unsigned int ... Orders>
+	static bool register_kernels(kernel_registry& registry);
+	///Get the built-in kernels for tables of a given dimension and, if it is
+	///uniform and in the built-in range, order, or NULL if there are none
+	static const kernel_pair* builtin_kernels(uint32_t ndim, uint32_t constOrder);
+	template<unsigned int D, unsigned int O>
+	static kernel_pair dimension_kernels(std::true_type /*uniform order*/);
+	template<unsigned int D, unsigned int O>
+	static kernel_pair dimension_kernels(std::false_type /*mixed orders*/);
+	template<unsigned int I>
+	static void fill_kernel_table(kernel_pair* table, std::true_type /*more*/);
+	template<unsigned int I>
+	static void fill_kernel_table(kernel_pair* /*table*/, std::false_type /*done*/){}
+#ifdef PHOTOSPLINE_SIMD_DISPATCH
+	template<typename Vec, unsigned int D, unsigned int O>
+	void ndsplineeval_multibasis_core_wide(const int *centers, const v4sf*** localbasis, v4sf* result) const;
+	template<unsigned int D, unsigned int O>
+	void ndsplineeval_multibasis_core_avx2(const int *centers, const v4sf*** localbasis, v4sf* result) const;
+	template<unsigned int D, unsigned int O>
+	void ndsplineeval_multibasis_core_avx512(const int *centers, const v4sf*** localbasis, v4sf* result) const;
+	template<unsigned int D>
+	static multibasis_kernel simd_multibasis_kernel(simd_variant variant, uint32_t constOrder);
+#endif
+
 	template<typename T>
 	typename allocator_traits::template rebind_traits<T>::pointer allocate(size_t n){
 		typedef typename allocator_traits::template rebind_alloc<T> other_alloc_t;
@@ -816,8 +1668,50 @@ private:
 		other_alloc_traits::deallocate(other_alloc,buf,n);
 	}
 	
+	///The number of coefficients allocated, including any padding of tiles
+	uint64_t stored_ncoeffs() const;
+	///Get a reader for the stored coefficients, which must be of type Coeff
+	template<typename Coeff>
+	detail::coefficient_reader<Coeff> stored_coefficients() const{
+		return(detail::coefficient_reader<Coeff>(storage==coefficient_storage::float32 ?
+		  reinterpret_cast<const char*>(&coefficients[0]) : &packed_coefficients[0],
+		  block_parameters ? &block_parameters[0] : NULL, block_shift));
+	}
+	///Copy n coefficients, starting from the given index in the standard
+	///row-major order, from storage in any layout and type
+	void gather_coefficients(uint64_t first, uint64_t n, double* out) const;
+	template<typename Coeff>
+	void gather_coefficients(uint64_t first, uint64_t n, double* out) const;
+	///Move the coefficients into the tiled layout with the given tile
+	///extents, or into the standard layout if tileExtents is NULL, stored
+	///as the given type
+	void set_layout(const uint32_t* tileExtents, coefficient_storage newStorage);
+	template<typename Coeff>
+	void set_layout(const uint32_t* tileExtents, coefficient_storage newStorage);
+	///Make the offsets of coefficients in the tiled layout with the given
+	///extents, or in the standard layout if tileExtents is NULL
+	///\param nstored will be set to the number of coefficients to allocate
+	uint64_t_ptr_ptr make_coefficient_offsets(const uint32_t* tileExtents, uint64_t& nstored);
+	///Quantize the coefficients to integers of type Int, in tiles with the
+	///given extents
+	///\return the largest absolute change to any coefficient
+	template<typename Int>
+	double quantize_coefficients(const uint32_t* tileExtents);
+	///Deallocate the coefficients and the description of their layout
+	void release_coefficients();
+	///Throw if the coefficients are not untiled floats
+	void require_standard_coefficients(const std::string& operation) const{
+		if(coefficient_offsets)
+			throw std::runtime_error(operation+" requires untiled coefficients stored as float; "
+			                         "call untile_coefficients and set_coefficient_storage first");
+	}
+	
 	///Read from a file
-	bool read_fits_core(fitsfile*, const std::string& filePath="");
+	bool read_fits_core(fitsfile*, const std::string& filePath="",
+	                    coefficient_storage newStorage=coefficient_storage::float32);
+	///Read the coefficients from a file, converting them to Coeff
+	template<typename Coeff>
+	void read_fits_coefficients(fitsfile*, int& error);
 	
 	///Write to a file
 	void write_fits_core(fitsfile*) const;
@@ -832,6 +1726,17 @@ private:
 #include "photospline/detail/fitsio.h"
 #include "photospline/detail/sample.h"
 #include "photospline/detail/permute.h"
+#include "photospline/detail/tiling.h"
+#include "photospline/detail/quantization.h"
+#include "photospline/detail/table_group.h"
+#include "photospline/detail/cursor.h"
+#include "photospline/detail/parallel_eval.h"
+#include "photospline/detail/pipelined_eval.h"
+#include "photospline/detail/polynomial.h"
+#include "photospline/detail/tensor_train.h"
+#include "photospline/detail/static_eval.h"
+#include "photospline/detail/basis_row.h"
+#include "photospline/detail/grideval_dense.h"
 
 #ifdef PHOTOSPLINE_INCLUDES_SPGLAM
 #include "photospline/detail/fit.h"
@@ -220,6 +220,241 @@ bspline_deriv_nonzero(const double* knots, const unsigned nknots,
 
 }
 
+/*
+ * A reimplementation of de Boor's BSPLVD, which generates the values and
+ * the first nderiv derivatives of the non-zero B-splines at x in one pass.
+ * The values of the splines of each order up to n are found from the
+ * bottom up, as in bsplvb(), and those of order n-d are saved along the
+ * way. The dth derivative of the nth order splines is then a linear
+ * combination of these, formed by differentiating d times, each time
+ * raising the order by one exactly as bspline_deriv_nonzero() does.
+ * The dth derivative of the ith non-zero spline is stored in
+ * values[d*(n+1)+i]. `left' has the same meaning as for
+ * bspline_deriv_nonzero().
+ */
+
+void
+bsplvd(const double* knots, const unsigned nknots,
+    const double x, int left, const int n, const int nderiv, float* values)
+{
+	int i, j, d, m;
+	const int w = n+1;
+	const int top = (nderiv < n) ? nderiv : n;
+	double saved, term, denom, prev, cur;
+	double delta_l[w], delta_r[w];
+	double rows[(top+1)*w];
+	/*
+	 * The values are kept in single precision, as by bsplvb(), so that the
+	 * values and first derivatives are identical to those from
+	 * bsplvb_simple() and bspline_deriv_nonzero().
+	 */
+	float biatx[w];
+	
+	/*
+	 * Handle the (rare) cases where x is outside the full
+	 * support of the spline surface.
+	 */
+	if (left == n)
+		while (left >= 0 && x < knots[left])
+			left--;
+	else if (left == (int)nknots-n-2)
+		while (left < (int)nknots-1 && x > knots[left+1])
+			left++;
+	
+	/* Raise the order of the splines from 0 to n, saving the last top+1 */
+	biatx[0] = 1.0;
+	for (j = 0; ; j++) {
+		if (n-j <= top)
+			for (i = 0; i < j+1; i++)
+				rows[(n-j)*w+i] = biatx[i];
+		if (j == n)
+			break;
+		
+		delta_r[j] = knots[left+j+1] - x;
+		delta_l[j] = x - knots[left-j];
+		
+		saved = 0.0;
+		
+		for (i = 0; i < j+1; i++) {
+			term = biatx[i] / (delta_r[i] + delta_l[j-i]);
+			biatx[i] = saved + delta_r[i]*term;
+			saved = delta_l[j-i]*term;
+		}
+		
+		biatx[j+1] = saved;
+	}
+	
+	/*
+	 * Differentiate the saved splines of order n-d d times. Each step
+	 * turns the m values of the order m-1 splines into the m+1 values of
+	 * the derivatives of the order m splines; the derivative of the ith
+	 * is m times the difference of the i-1th and ith lower order splines,
+	 * each divided by the span of its knots. Splines on zero-length spans
+	 * are identically zero, and contribute nothing.
+	 */
+	for (d = 1; d <= top; d++) {
+		double* row = &rows[d*w];
+		for (m = n-d+1; m <= n; m++) {
+			prev = 0.0;
+			for (i = 0; i <= m; i++) {
+				cur = 0.0;
+				if (i < m) {
+					denom = knots[left+i+1] - knots[left+i+1-m];
+					if (denom > 0)
+						cur = m*row[i]/denom;
+				}
+				row[i] = prev - cur;
+				prev = cur;
+			}
+		}
+	}
+	
+	for (d = 0; d <= nderiv; d++) {
+		float* out = &values[d*w];
+		if (d > top) {
+			/* Derivatives beyond the order of the splines vanish. */
+			for (i = 0; i < w; i++)
+				out[i] = 0.0;
+			continue;
+		}
+		for (i = 0; i < w; i++)
+			out[i] = rows[d*w+i];
+		
+		/* Rearrange for partially-supported points. */
+		if ((i = n-left) > 0) {
+			for (j = 0; j < left+1; j++)
+				out[j] = out[j+i]; /* Move valid splines over. */
+			for ( ; j < n+1; j++)
+				out[j] = 0.0; /* The rest are zero by construction. */
+		} else if ((i = left+n+2-nknots) > 0) {
+			for (j = n; j > i-1; j--)
+				out[j] = out[j-i];
+			for ( ; j >= 0; j--)
+				out[j] = 0.0;
+		}
+	}
+}
+
+/*
+ * Division-free versions of the routines above. The divisors of the
+ * recurrences are differences of knots, delta_r[i] + delta_l[j-i] being
+ * knots[left+i+1] - knots[left+i-j], so their reciprocals can be found once
+ * for a set of knots, and the recurrences multiply by them instead. This
+ * rounds differently, so the results may differ from those of the dividing
+ * routines in their last bits.
+ *
+ * knot_reciprocals() fills recip, of length order*nknots, with
+ * recip[(s-1)*nknots + m] = 1/(knots[m+s] - knots[m]) for 1 <= s <= order,
+ * or zero where the difference is zero or runs off the end of the knots.
+ */
+
+void
+knot_reciprocals(const double* knots, const unsigned nknots, const int order,
+    double* recip)
+{
+	int s;
+	unsigned m;
+	
+	for (s = 1; s <= order; s++) {
+		for (m = 0; m < nknots; m++) {
+			double diff = (m+s < nknots) ? knots[m+s] - knots[m] : 0;
+			recip[(s-1)*nknots + m] = (diff > 0) ? 1./diff : 0;
+		}
+	}
+}
+
+/*
+ * As bsplvb(), but each of the knot differences spans the interval
+ * containing x, so that all are in the table.
+ */
+
+void
+bsplvb_reciprocal(const double* knots, const double* recip, const unsigned nknots,
+    const double x, const int left, const int jlow, const int jhigh, float* biatx,
+    double* delta_l, double* delta_r)
+{
+	int i, j;
+	double saved, term;
+	const double* r;
+	
+	if (jlow == 0)
+		biatx[0] = 1.0;
+	
+	for (j = jlow; j < jhigh-1; j++) {
+		delta_r[j] = knots[left+j+1] - x;
+		delta_l[j] = x - knots[left-j];
+		/* r[i] = 1/(knots[left+i+1] - knots[left+i-j]) */
+		r = recip + j*nknots + left - j;
+		
+		saved = 0.0;
+		
+		for (i = 0; i < j+1; i++) {
+			term = biatx[i] * r[i];
+			biatx[i] = saved + delta_r[i]*term;
+			saved = delta_l[j-i]*term;
+		}
+		
+		biatx[j+1] = saved;
+	}
+}
+
+/*
+ * Outside the full support of the spline surface, the splines are
+ * rearranged, and knots beyond the ends of the table are involved; the
+ * reciprocal routines leave these (rare) cases to the dividing ones.
+ */
+
+void
+bsplvb_simple_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, double x, int left, int degree, float* biatx)
+{
+	double delta_l[degree], delta_r[degree];
+	
+	if ((left == degree-1 && x < knots[left]) ||
+	    (left == nknots-degree-1 && x > knots[left+1])) {
+		bsplvb_simple(knots, nknots, x, left, degree, biatx);
+		return;
+	}
+	
+	bsplvb_reciprocal(knots, recip, nknots, x, left, 0, degree, biatx,
+	    delta_l, delta_r);
+}
+
+void
+bspline_deriv_nonzero_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, const double x, const int left, const int n,
+    float* biatx)
+{
+	int i;
+	double temp, a;
+	double delta_l[n], delta_r[n];
+	const double* r;
+	
+	if (n == 0 || (left == n && x < knots[left]) ||
+	    (left == nknots-n-2 && x > knots[left+1])) {
+		bspline_deriv_nonzero(knots, nknots, x, left, n, biatx);
+		return;
+	}
+	
+	/* Get the non-zero n-1th order B-splines at x */
+	bsplvb_reciprocal(knots, recip, nknots, x, left, 0, n, biatx,
+	    delta_l, delta_r);
+	
+	/*
+	 * Combine them as bspline_deriv_nonzero() does, with
+	 * r[m] = 1/(knots[m+n] - knots[m]).
+	 */
+	r = recip + (n-1)*nknots;
+	temp = biatx[0];
+	biatx[0] = - n*temp*r[left+1-n];
+	for (i = 1; i < n; i++) {
+		a = n*temp*r[left+i-n];
+		temp = biatx[i];
+		biatx[i] = a - n*temp*r[left+i+1-n];
+	}
+	biatx[n] = n*temp*r[left];
+}
+
 double
 bspline_deriv(const double *knots, double x, int i, int n, unsigned order)
 {
@@ -92,4 +92,42 @@ bspline_nonzero(const double* knots, const unsigned nknots,
 	}
 }
 
+/*
+ * As bspline_nonzero(), but division-free, using the reciprocals of the
+ * knot differences from knot_reciprocals().
+ */
+
+void
+bspline_nonzero_reciprocal(const double* knots, const double* recip,
+    const unsigned nknots, const double x, int left, const int n,
+    float* values, float* derivs)
+{
+	if (n == 0 || (left == n && x < knots[left]) ||
+	    (left == nknots-n-2 && x > knots[left+1])) {
+		bspline_nonzero(knots, nknots, x, left, n, values, derivs);
+		return;
+	}
+	
+	double delta_r[n+1], delta_l[n+1];
+	
+	/* Get the non-zero n-1th order B-splines at x */
+	bsplvb_reciprocal(knots, recip, nknots, x, left, 0, n, values,
+	    delta_l, delta_r);
+	
+	/* Form the derivatives as bspline_deriv_nonzero_reciprocal() does. */
+	const double* r = recip + (n-1)*nknots;
+	double temp = values[0];
+	derivs[0] = - n*temp*r[left+1-n];
+	for (int i = 1; i < n; i++) {
+		double a = n*temp*r[left+i-n];
+		temp = values[i];
+		derivs[i] = a - n*temp*r[left+i+1-n];
+	}
+	derivs[n] = n*temp*r[left];
+	
+	/* Now, continue to the non-zero nth order B-splines at x */
+	bsplvb_reciprocal(knots, recip, nknots, x, left, n-1, n+1, values,
+	    delta_l, delta_r);
+}
+
 } //namespace photospline
@@ -462,8 +462,15 @@ pysplinetable_getcoeffcients(pysplinetable* self, void *closure){
 		dims[i] = self->table->get_ncoeffs(i);
 		strides[i] = sizeof(float)*self->table->get_stride(i);
 	}
+	const float* coefficients;
+	try{
+		coefficients=self->table->get_coefficients();
+	}catch(std::exception& ex){
+		PyErr_SetString(PyExc_ValueError, ex.what());
+		return(NULL);
+	}
 	PyObject* arr=PyArray_New(&PyArray_Type, ndim, dims, NPY_FLOAT, strides,
-	    (void*)self->table->get_coefficients(), sizeof(float),
+	    (void*)coefficients, sizeof(float),
 #if NUMPY_API_GEN == 0 //numpy < 1.7
 	    NPY_CARRAY_RO, (PyObject*)self);
 	((PyArrayObject*)arr)->base=(PyObject*)self;
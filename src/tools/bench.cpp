@@ -9,5 +9,7 @@ int main(int argc, char* argv[]){
 	photospline::splinetable<> spline(argv[1]);
 	unsigned dim=spline.get_ndim();
 	unsigned int iterations=(8.e7*exp(-(double)dim/1.4427));
+	std::cout << "Using " << photospline::simd_variant_name(spline.get_evaluator().get_simd_variant())
+	  << " evaluation kernels" << std::endl;
 	spline.benchmark_evaluation(iterations,true);
 }
\ No newline at end of file
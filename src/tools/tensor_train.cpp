@@ -0,0 +1,89 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include <photospline/splinetable.h>
+
+int main(int argc, char* argv[]){
+	if(argc<3 || argc>4){
+		std::cerr << "Usage: photospline-tensor-train spline_file tolerance [max_rank]" << std::endl;
+		return(1);
+	}
+	
+	photospline::splinetable<> spline;
+	try{
+		spline.read_fits(argv[1]);
+	}catch(std::exception& ex){
+		std::cerr << ex.what() << std::endl;
+		return(1);
+	}
+	double tolerance;
+	unsigned long maxRank=std::numeric_limits<uint32_t>::max();
+	{
+		std::istringstream ss(argv[2]);
+		ss >> tolerance;
+		if(ss.fail()){
+			std::cerr << "Failed to interpret \"" << argv[2] << "\" as a tolerance" << std::endl;
+			return(1);
+		}
+		if(argc==4){
+			ss.clear();
+			ss.str(argv[3]);
+			ss >> maxRank;
+			if(ss.fail()){
+				std::cerr << "Failed to interpret \"" << argv[3] << "\" as a rank" << std::endl;
+				return(1);
+			}
+		}
+	}
+	
+	typedef std::chrono::high_resolution_clock clock;
+	clock::time_point t1=clock::now();
+	std::unique_ptr<photospline::splinetable<>::tensor_train> train;
+	try{
+		train.reset(new photospline::splinetable<>::tensor_train(spline,tolerance,
+		  std::min<unsigned long>(maxRank,std::numeric_limits<uint32_t>::max())));
+	}catch(std::exception& ex){
+		std::cerr << ex.what() << std::endl;
+		return(1);
+	}
+	clock::time_point t2=clock::now();
+	const unsigned ndim=spline.get_ndim();
+	std::cout << "Decomposed in " << std::chrono::duration<double>(t2-t1).count() << " seconds" << std::endl;
+	std::cout << "Ranks: ";
+	for(unsigned i=0; i<=ndim; i++)
+		std::cout << train->get_rank(i) << ' ';
+	std::cout << std::endl;
+	const size_t tableBytes=spline.get_ncoeffs()*photospline::coefficient_storage_size(spline.get_coefficient_storage());
+	std::cout << "Memory: " << train->memory_usage() << " bytes, against " << tableBytes
+	<< " for the table (" << double(tableBytes)/train->memory_usage() << "x smaller)" << std::endl;
+	std::cout << "Root-sum-square change to the coefficients: " << train->error_bound() << std::endl;
+	
+	//compare values and speeds at random points
+	const size_t trialCount=100000;
+	std::default_random_engine rng(52);
+	std::vector<double> points(trialCount*ndim);
+	for(unsigned i=0; i<ndim; i++){
+		std::uniform_real_distribution<> dist(spline.lower_extent(i),spline.upper_extent(i));
+		for(size_t j=0; j<trialCount; j++)
+			points[j*ndim+i]=dist(rng);
+	}
+	const photospline::splinetable<>::evaluator eval=spline.get_evaluator();
+	std::vector<double> values(trialCount);
+	double maxError=0;
+	t1=clock::now();
+	for(size_t j=0; j<trialCount; j++)
+		values[j]=eval(&points[j*ndim]);
+	t2=clock::now();
+	const double tableTime=std::chrono::duration<double>(t2-t1).count();
+	t1=clock::now();
+	for(size_t j=0; j<trialCount; j++)
+		maxError=std::max(maxError,std::abs((*train)(&points[j*ndim])-values[j]));
+	t2=clock::now();
+	const double trainTime=std::chrono::duration<double>(t2-t1).count();
+	std::cout << "Largest change to a value at " << trialCount << " random points: " << maxError << std::endl;
+	std::cout << "Evaluations per second: " << trialCount/trainTime << ", against "
+	<< trialCount/tableTime << " for the table" << std::endl;
+	return(0);
+}
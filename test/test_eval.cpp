@@ -1,5 +1,8 @@
 #include "test.h"
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
 #include <random>
 #include <vector>
 
@@ -77,9 +80,7 @@ TEST(ndssplineeval_vs_call_operator){
 	}
 }
 
-void test_evaluator_interface(const std::string& splinePath){
-	std::cout << "Testing evaluation of " << splinePath << std::endl;
-	photospline::splinetable<> spline(splinePath);
+void test_evaluator_interface(const photospline::splinetable<>& spline){
 	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
 	const int ndim = spline.get_ndim();
 	ENSURE(ndim < 6);
@@ -135,6 +136,11 @@ void test_evaluator_interface(const std::string& splinePath){
 	}
 }
 
+void test_evaluator_interface(const std::string& splinePath){
+	std::cout << "Testing evaluation of " << splinePath << std::endl;
+	test_evaluator_interface(photospline::splinetable<>(splinePath));
+}
+
 TEST(evaluator_interface){
 	test_evaluator_interface("test_data/test_spline_2d.fits");
 	test_evaluator_interface("test_data/test_spline_2d_nco.fits");
@@ -320,6 +326,100 @@ TEST(bspline_deriv_nonzero_vs_bspline_deriv){
 	}
 }
 
+TEST(bsplvd_vs_bspline_deriv){
+	const size_t n_knots = 16;
+	std::mt19937 rng;
+	rng.seed(342);
+	
+	for (int order : {2, 3, 5}) {
+		const int nderiv = order+1;
+		std::vector<float> derivs((nderiv+1)*(order+1));
+		std::vector<double> knotvec;
+		
+		// Generate a random knot field.
+		{
+			//insert dummy knots in anticipation of what would otherwise be out-of-bounds accesses
+			knotvec.insert(knotvec.end(),order,0.);
+			std::uniform_real_distribution<> uniform(0,1);
+			for (size_t i = 0; i < n_knots; i++)
+				knotvec.push_back(uniform(rng));
+			knotvec.insert(knotvec.end(),order,0.); //more dummy knots
+		}
+		std::sort(knotvec.begin()+order, knotvec.begin()+order+n_knots);
+		const double* knots = knotvec.data()+order; //offset past inital dummy knots
+		
+		// Every knot interval, including those which are only partially supported.
+		for (size_t i = 0; i < n_knots-2; i++) {
+			double x = (knots[i]+knots[i+1])/2.0;
+			int center = std::min(std::max(int(i), order), int(n_knots)-order-2);
+			
+			photospline::bsplvd(knots, n_knots, x, center, order, nderiv, derivs.data());
+			
+			for (int d = 0; d <= nderiv; d++) {
+				for (int offset = -order; offset <= 0; offset++) {
+					double expected = (d == 0) ?
+					  photospline::bspline(knots, x, center + offset, order) :
+					  photospline::bspline_deriv(knots, x, center + offset, order, d);
+					// Higher derivatives are large, and less stable.
+					ENSURE_DISTANCE(double(derivs[d*(order+1) + offset+order]), expected,
+					                1e-4*std::abs(expected) + 10*std::numeric_limits<float>::epsilon());
+				}
+			}
+		}
+	}
+}
+
+TEST(knot_reciprocals_vs_division){
+	const size_t n_knots = 16;
+	std::mt19937 rng;
+	rng.seed(343);
+	
+	for (int order : {1, 2, 3, 5}) {
+		std::vector<double> knotvec;
+		std::vector<float> expected(order+1), expected_deriv(order+1);
+		std::vector<float> values(order+1), derivs(order+1);
+		
+		// Generate a random knot field.
+		{
+			//insert dummy knots in anticipation of what would otherwise be out-of-bounds accesses
+			knotvec.insert(knotvec.end(),order,0.);
+			std::uniform_real_distribution<> uniform(0,1);
+			for (size_t i = 0; i < n_knots; i++)
+				knotvec.push_back(uniform(rng));
+			knotvec.insert(knotvec.end(),order,0.); //more dummy knots
+		}
+		std::sort(knotvec.begin()+order, knotvec.begin()+order+n_knots);
+		const double* knots = knotvec.data()+order; //offset past inital dummy knots
+		std::vector<double> recip(order*n_knots);
+		photospline::knot_reciprocals(knots, n_knots, order, recip.data());
+		
+		// Every knot interval, including those which are only partially supported.
+		for (size_t i = 0; i < n_knots-1; i++) {
+			for (double frac : {0., 0.3, 0.7}) {
+				double x = knots[i] + frac*(knots[i+1]-knots[i]);
+				int center = std::min(std::max(int(i), order), int(n_knots)-order-2);
+				
+				photospline::bsplvb_simple(knots, n_knots, x, center, order+1, expected.data());
+				photospline::bsplvb_simple_reciprocal(knots, recip.data(), n_knots, x, center, order+1, values.data());
+				for (int k = 0; k <= order; k++)
+					ENSURE_DISTANCE(values[k], expected[k], 4*std::numeric_limits<float>::epsilon());
+				
+				photospline::bspline_deriv_nonzero(knots, n_knots, x, center, order, expected_deriv.data());
+				photospline::bspline_deriv_nonzero_reciprocal(knots, recip.data(), n_knots, x, center, order, derivs.data());
+				for (int k = 0; k <= order; k++)
+					ENSURE_DISTANCE(derivs[k], expected_deriv[k], 1e-5f*(1+std::abs(expected_deriv[k])));
+				
+				photospline::bspline_nonzero(knots, n_knots, x, center, order, expected.data(), expected_deriv.data());
+				photospline::bspline_nonzero_reciprocal(knots, recip.data(), n_knots, x, center, order, values.data(), derivs.data());
+				for (int k = 0; k <= order; k++) {
+					ENSURE_DISTANCE(values[k], expected[k], 4*std::numeric_limits<float>::epsilon());
+					ENSURE_DISTANCE(derivs[k], expected_deriv[k], 1e-5f*(1+std::abs(expected_deriv[k])));
+				}
+			}
+		}
+	}
+}
+
 TEST(bspline_nonzero_vs_bspline){
 	const size_t n_knots = 10;
 	const int order = 2;
@@ -529,6 +629,18 @@ TEST(evaluation_benchmark){
 	}
 }
 
+//the fused gradient must not fall behind evaluating each derivative separately
+TEST(gradient_throughput){
+	for(size_t dim=2; dim<6; dim++){
+		for(std::string suffix : {"", "_nco"}){
+			photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d"+suffix+".fits");
+			auto result=spline.benchmark_evaluation((unsigned int)(1.e6*exp(-(double)dim/1.4427)));
+			ENSURE(result.gradient_multi_eval_rate>result.gradient_single_eval_rate/2,
+			       "Fused gradient evaluation should not be much slower than separate derivative evaluations");
+		}
+	}
+}
+
 TEST(permutation){
 	const std::string splinePath="test_data/test_spline_4d_nco.fits";
 	
@@ -567,4 +679,1429 @@ TEST(permutation){
 		//intermediate steps, so fairly generour error tolerances are needed here.
 		ENSURE_DISTANCE(evaluate,evaluateP,std::max(std::abs(evaluate*1e-4),1e-4),"Permuted spline should give same result for permuted coordinates");
 	}
-}
\ No newline at end of file
+}
+void test_batch_evaluation(const photospline::splinetable<>& spline){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const int ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(62);
+	
+	//Sample a region slightly larger than the support of the spline, so that
+	//some points fall outside of it
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(size_t i=0; i<ndim; i++){
+		double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin));
+	}
+	
+	//use a number of points which does not fill the last batch
+	const size_t npoints=1001;
+	std::vector<std::vector<double>> coords(ndim,std::vector<double>(npoints));
+	std::vector<const double*> coordPtrs(ndim);
+	for(size_t j=0; j<ndim; j++){
+		for(size_t i=0; i<npoints; i++)
+			coords[j][i]=dists[j](rng);
+		coordPtrs[j]=coords[j].data();
+	}
+	std::vector<double> point(ndim), results(npoints);
+	std::vector<int> centers(ndim);
+	
+	for(int derivatives=0; derivatives<2; derivatives++){
+		evaluator.ndsplineeval_batch(coordPtrs.data(), npoints, results.data(), derivatives);
+		for(size_t i=0; i<npoints; i++){
+			for(size_t j=0; j<ndim; j++)
+				point[j]=coords[j][i];
+			double evaluate=0;
+			if(evaluator.searchcenters(point.data(), centers.data()))
+				evaluate=evaluator.ndsplineeval(point.data(), centers.data(), derivatives);
+			ENSURE_EQUAL(results[i], evaluate,
+			             "evaluator::ndsplineeval_batch() and evaluator::ndsplineeval() yield identical evaluates");
+		}
+	}
+}
+
+TEST(evaluator_batch){
+	for(size_t dim=1; dim<6; dim++){
+		test_batch_evaluation(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d.fits"));
+		test_batch_evaluation(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d_nco.fits"));
+	}
+}
+
+TEST(evaluator_batch_few_knots){
+	//a stacked dimension of two tables, with the smallest number of
+	//coefficients which can fully support a knot
+	photospline::splinetable<> first("test_data/test_spline_1d.fits"), second("test_data/test_spline_1d.fits");
+	photospline::splinetable<> spline({&first, &second}, {0., 1.}, 3);
+	ENSURE_EQUAL(spline.get_ncoeffs(1), uint64_t(spline.get_order(1)+1));
+	test_batch_evaluation(spline);
+}
+
+TEST(evaluator_parallel){
+	photospline::splinetable<> spline("test_data/test_spline_4d.fits");
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const int ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(63);
+	
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(size_t i=0; i<ndim; i++){
+		double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin));
+	}
+	
+	//use enough points for many chunks, the last of them partial
+	const size_t npoints=20001;
+	std::vector<std::vector<double>> coords(ndim,std::vector<double>(npoints));
+	std::vector<const double*> coordPtrs(ndim);
+	for(size_t j=0; j<ndim; j++){
+		for(size_t i=0; i<npoints; i++)
+			coords[j][i]=dists[j](rng);
+		coordPtrs[j]=coords[j].data();
+	}
+	std::vector<double> expected(npoints), results(npoints);
+	
+	for(int derivatives=0; derivatives<2; derivatives++){
+		evaluator.ndsplineeval_batch(coordPtrs.data(), npoints, expected.data(), derivatives);
+		for(unsigned int nthreads : {0u, 1u, 3u, 8u}){
+			std::fill(results.begin(), results.end(), -1);
+			evaluator.ndsplineeval_parallel(coordPtrs.data(), npoints, results.data(), derivatives, nthreads);
+			for(size_t i=0; i<npoints; i++)
+				ENSURE_EQUAL(results[i], expected[i],
+				             "evaluator::ndsplineeval_parallel() and evaluator::ndsplineeval_batch() yield identical evaluates");
+		}
+	}
+	
+	//too few points to share out are evaluated by the calling thread
+	evaluator.ndsplineeval_batch(coordPtrs.data(), 5, expected.data());
+	std::fill(results.begin(), results.end(), -1);
+	evaluator.ndsplineeval_parallel(coordPtrs.data(), 5, results.data(), 0, 4);
+	for(size_t i=0; i<5; i++)
+		ENSURE_EQUAL(results[i], expected[i], "evaluator::ndsplineeval_parallel() evaluates a partial chunk");
+	ENSURE_EQUAL(results[5], -1, "evaluator::ndsplineeval_parallel() writes only the requested results");
+}
+
+void test_pipelined_evaluation(const photospline::splinetable<>& spline){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const int ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(65);
+	
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(size_t i=0; i<ndim; i++){
+		double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin));
+	}
+	
+	//use a number of points which does not fill the last window
+	const size_t npoints=1003;
+	std::vector<std::vector<double>> coords(ndim,std::vector<double>(npoints));
+	std::vector<const double*> coordPtrs(ndim);
+	for(size_t j=0; j<ndim; j++){
+		for(size_t i=0; i<npoints; i++)
+			coords[j][i]=dists[j](rng);
+		coordPtrs[j]=coords[j].data();
+	}
+	std::vector<double> point(ndim), results(npoints);
+	
+	for(int derivatives=0; derivatives<2; derivatives++){
+		for(bool reorder : {false, true}){
+			std::fill(results.begin(), results.end(), -1);
+			evaluator.ndsplineeval_pipelined(coordPtrs.data(), npoints, results.data(), derivatives, reorder);
+			for(size_t i=0; i<npoints; i++){
+				for(size_t j=0; j<ndim; j++)
+					point[j]=coords[j][i];
+				ENSURE_EQUAL(results[i], evaluator(point.data(), derivatives),
+				             "evaluator::ndsplineeval_pipelined() and evaluator::operator() yield identical evaluates");
+			}
+		}
+	}
+}
+
+TEST(evaluator_pipelined){
+	for(size_t dim=1; dim<6; dim++)
+		test_pipelined_evaluation(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d.fits"));
+	//the coefficients to fetch are found in any layout
+	photospline::splinetable<> spline("test_data/test_spline_4d.fits");
+	spline.tile_coefficients();
+	test_pipelined_evaluation(spline);
+	spline.set_coefficient_storage(photospline::coefficient_storage::float16);
+	test_pipelined_evaluation(spline);
+	photospline::splinetable<> quantized("test_data/test_spline_3d.fits");
+	quantized.quantize_coefficients(photospline::coefficient_storage::int8);
+	test_pipelined_evaluation(quantized);
+}
+
+TEST(morton_key){
+	//with one dimension the key is the center itself, including its high bits
+	for(int center : {0, 1, 5, 1<<20, std::numeric_limits<int>::max()})
+		ENSURE_EQUAL(photospline::detail::morton_key(&center, 1), uint64_t(center));
+	int centers[2]={3, 5}; //0b011, 0b101
+	ENSURE_EQUAL(photospline::detail::morton_key(centers, 2), uint64_t(0x27)); //0b100111
+	//a 1-d table reordered by its keys
+	test_pipelined_evaluation(photospline::splinetable<>("test_data/test_spline_1d_nco.fits"));
+}
+
+TEST(evaluator_simd_variants){
+	for(size_t dim=1; dim<6; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		const int ndim = spline.get_ndim();
+		photospline::splinetable<>::evaluator baseline=spline.get_evaluator(photospline::simd_variant::generic);
+		ENSURE(baseline.get_simd_variant()==photospline::detail::baseline_simd_variant(),
+		       "Restricting the variant should select the baseline kernels");
+		
+		std::mt19937 rng;
+		rng.seed(17);
+		std::vector<std::uniform_real_distribution<>> dists;
+		for(size_t i=0; i<ndim; i++)
+			dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+		
+		std::vector<double> coords(ndim);
+		std::vector<int> centers(ndim);
+		std::vector<double> evaluate_with_gradient1(ndim+1), evaluate_with_gradient2(ndim+1);
+		
+		//every variant which this CPU can run should give the same results
+		for(auto variant : {photospline::simd_variant::sse4_2,photospline::simd_variant::avx2,photospline::simd_variant::avx512}){
+			photospline::splinetable<>::evaluator evaluator=spline.get_evaluator(variant);
+			ENSURE(evaluator.get_simd_variant()<=std::max(variant,baseline.get_simd_variant()),
+			       "The selected variant should not exceed the requested one");
+			for(size_t i=0; i<1000; i++){
+				for(size_t j=0; j<ndim; j++)
+					coords[j]=dists[j](rng);
+				
+				ENSURE(evaluator.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+				baseline.ndsplineeval_gradient(coords.data(), centers.data(), evaluate_with_gradient1.data());
+				evaluator.ndsplineeval_gradient(coords.data(), centers.data(), evaluate_with_gradient2.data());
+				for(int j=0; j < ndim+1; j++)
+					ENSURE_EQUAL(evaluate_with_gradient1[j], evaluate_with_gradient2[j],
+					             "All SIMD variants yield identical gradients");
+			}
+		}
+	}
+}
+
+void test_center_search(const photospline::splinetable<>& spline){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const int ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(29);
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(size_t i=0; i<ndim; i++){
+		const double* knots=spline.get_knots(i);
+		dists.push_back(std::uniform_real_distribution<>(knots[0]-1,knots[spline.get_nknots(i)-1]+1));
+	}
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers1(ndim), centers2(ndim);
+	auto compare=[&]{
+		bool found1=spline.searchcenters(coords.data(), centers1.data());
+		bool found2=evaluator.searchcenters(coords.data(), centers2.data());
+		ENSURE_EQUAL(found1, found2, "Center lookups should agree on which points are in the table");
+		if(found1){
+			for (int j=0; j < ndim; j++)
+				ENSURE_EQUAL(centers1[j],centers2[j],"Center lookups should yield same results");
+		}
+	};
+	
+	for(size_t i=0; i<10000; i++){
+		for(size_t j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		compare();
+	}
+	
+	//points exactly on, and just to either side of, every knot are the ones
+	//most likely to be assigned to the wrong interval
+	for(size_t j=0; j<ndim; j++)
+		coords[j]=.5*(spline.lower_extent(j)+spline.upper_extent(j));
+	for(size_t j=0; j<ndim; j++){
+		double middle=coords[j];
+		const double* knots=spline.get_knots(j);
+		for(size_t k=0; k<spline.get_nknots(j); k++){
+			for(double x : {std::nextafter(knots[k],-INFINITY),knots[k],std::nextafter(knots[k],INFINITY)}){
+				coords[j]=x;
+				compare();
+			}
+		}
+		coords[j]=middle;
+	}
+}
+
+TEST(evaluator_uniform_knots){
+	//none of the test splines has uniform knots in all dimensions, but
+	//stacking splines at evenly spaced coordinates adds a dimension which does
+	for(size_t dim=1; dim<5; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		std::vector<photospline::splinetable<>*> tables(7,&spline);
+		std::vector<double> coordinates;
+		for(size_t i=0; i<tables.size(); i++)
+			coordinates.push_back(.3*i-.1);
+		photospline::splinetable<> stacked(tables,coordinates);
+		photospline::splinetable<>::evaluator evaluator=stacked.get_evaluator();
+		
+		for(size_t j=0; j<dim; j++)
+			ENSURE(!evaluator.has_uniform_knots(j), "Test spline knots are not uniform");
+		ENSURE(evaluator.has_uniform_knots(dim), "Stacked dimension knots are uniform");
+		
+		test_center_search(stacked);
+		test_batch_evaluation(stacked);
+	}
+	
+	//centers are only computed directly for dimensions with many knots
+	{
+		photospline::splinetable<> spline("test_data/test_spline_1d.fits");
+		std::vector<photospline::splinetable<>*> tables(2000,&spline);
+		std::vector<double> coordinates;
+		for(size_t i=0; i<tables.size(); i++)
+			coordinates.push_back(.01*i-3);
+		photospline::splinetable<> stacked(tables,coordinates);
+		ENSURE(stacked.get_evaluator().has_uniform_knots(1), "Stacked dimension knots are uniform");
+		test_center_search(stacked);
+		test_batch_evaluation(stacked);
+	}
+	
+	for(size_t dim=1; dim<6; dim++){
+		test_center_search(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d.fits"));
+		test_center_search(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d_nco.fits"));
+	}
+}
+
+TEST(knot_search){
+	using photospline::detail::knot_search;
+	const uint32_t order=2;
+	std::mt19937 rng;
+	rng.seed(41);
+	
+	auto check=[&](const std::vector<double>& knots, knot_search::method expected){
+		const uint64_t naxes=knots.size()-order-1;
+		knot_search search(knots.data(),knots.size(),order,naxes);
+		ENSURE(search.lookup==expected, "Expected center lookup method should be chosen");
+		//the center as defined by splinetable::searchcenters
+		auto reference=[&](double x)->int{
+			if(x<knots[order])
+				return(order);
+			if(x>=knots[naxes])
+				return(naxes-1);
+			return(std::upper_bound(knots.begin()+order,knots.begin()+naxes,x)-knots.begin()-1);
+		};
+		std::uniform_real_distribution<> dist(knots.front(),knots.back());
+		for(size_t i=0; i<10000; i++){
+			double x=dist(rng);
+			ENSURE_EQUAL(search.center(x),reference(x),"Center lookup should match bisection");
+		}
+		for(double knot : knots){
+			for(double x : {std::nextafter(knot,-INFINITY),knot,std::nextafter(knot,INFINITY)})
+				ENSURE_EQUAL(search.center(x),reference(x),"Center lookup should match bisection at knots");
+		}
+	};
+	
+	for(size_t n : {16, 64, 2000}){
+		std::vector<double> uniform(n), logarithmic(n);
+		for(size_t i=0; i<n; i++){
+			//a spacing which is not exactly representable
+			uniform[i]=.1*i-7;
+			logarithmic[i]=std::exp(10.*i/n);
+		}
+		check(uniform, n>knot_search::min_direct_intervals ? knot_search::method::direct : knot_search::method::bisection);
+		check(logarithmic, knot_search::method::bisection);
+	}
+	{
+		const size_t n=20000;
+		std::vector<double> logarithmic(n);
+		for(size_t i=0; i<n; i++)
+			logarithmic[i]=std::exp(10.*i/n);
+		check(logarithmic, knot_search::method::table);
+		//repeated knots leave several knots which may be the center in a bucket
+		for(size_t i=order+1; i<n-order-1; i+=97)
+			logarithmic[i]=logarithmic[i-1];
+		check(logarithmic, knot_search::method::table);
+	}
+}
+
+void test_hunt_centers(const photospline::splinetable<>& spline){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const int ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(53);
+	std::uniform_real_distribution<> jump(0,1);
+	std::vector<double> coords(ndim), widths(ndim);
+	for(size_t j=0; j<ndim; j++){
+		coords[j]=.5*(spline.lower_extent(j)+spline.upper_extent(j));
+		widths[j]=spline.upper_extent(j)-spline.lower_extent(j);
+	}
+	
+	std::vector<int> centers(ndim), centers1(ndim,-5), centers2(ndim,1<<20);
+	for(size_t i=0; i<10000; i++){
+		//mostly small steps, with some long jumps and some points outside
+		//the table
+		double scale=(i%100==0) ? .5 : (i%10==0 ? .05 : .002);
+		for(size_t j=0; j<ndim; j++)
+			coords[j]+=scale*widths[j]*(2*jump(rng)-1);
+		if(i%1000==999){
+			for(size_t j=0; j<ndim; j++)
+				coords[j]=.5*(spline.lower_extent(j)+spline.upper_extent(j));
+		}
+		
+		bool found=spline.searchcenters(coords.data(), centers.data());
+		bool found1=spline.huntcenters(coords.data(), centers1.data());
+		bool found2=evaluator.huntcenters(coords.data(), centers2.data());
+		ENSURE_EQUAL(found, found1, "splinetable::huntcenters() should find the same points in the table");
+		ENSURE_EQUAL(found, found2, "evaluator::huntcenters() should find the same points in the table");
+		if(!found)
+			continue;
+		for (int j=0; j < ndim; j++){
+			ENSURE_EQUAL(centers[j],centers1[j],"splinetable::huntcenters() should yield the same centers");
+			ENSURE_EQUAL(centers[j],centers2[j],"evaluator::huntcenters() should yield the same centers");
+		}
+	}
+}
+
+TEST(huntcenters){
+	for(size_t dim=1; dim<6; dim++){
+		test_hunt_centers(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d.fits"));
+		test_hunt_centers(photospline::splinetable<>("test_data/test_spline_"+std::to_string(dim)+"d_nco.fits"));
+	}
+	
+	//a dimension with enough uniform knots that the evaluator computes
+	//centers directly when the hint is wrong
+	photospline::splinetable<> spline("test_data/test_spline_1d.fits");
+	std::vector<photospline::splinetable<>*> tables(2000,&spline);
+	std::vector<double> coordinates;
+	for(size_t i=0; i<tables.size(); i++)
+		coordinates.push_back(.01*i-3);
+	test_hunt_centers(photospline::splinetable<>(tables,coordinates));
+}
+
+void test_tiled_evaluation(const std::string& splinePath, uint32_t tileSize){
+	photospline::splinetable<> spline(splinePath);
+	photospline::splinetable<> tiled(splinePath);
+	tiled.tile_coefficients(tileSize);
+	const int ndim = spline.get_ndim();
+	ENSURE(tiled.is_tiled(), "Tiling should change the coefficient layout");
+	for(int i=0; i<ndim; i++)
+		ENSURE(tiled.get_tile_extent(i)>0 && tiled.get_tile_extent(i)<=spline.get_ncoeffs(i),
+		       "Tiles should be no larger than the table");
+	ENSURE(tiled==spline, "Tiling should not change the spline");
+	
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	photospline::splinetable<>::evaluator tiledEvaluator=tiled.get_evaluator();
+	
+	std::mt19937 rng;
+	rng.seed(23);
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers(ndim);
+	std::vector<unsigned int> derivatives(ndim, 0);
+	std::vector<double> gradient1(ndim+1), gradient2(ndim+1);
+	for(size_t i=0; i<1000; i++){
+		for(int j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		ENSURE(spline.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+		
+		for(int d=0; d<ndim+1; d++){
+			int mask=(d<ndim ? 1<<d : 0);
+			ENSURE_EQUAL(spline.ndsplineeval(coords.data(), centers.data(), mask),
+			             tiled.ndsplineeval(coords.data(), centers.data(), mask),
+			             "Tiled and untiled tables yield identical evaluates");
+			ENSURE_EQUAL(evaluator.ndsplineeval(coords.data(), centers.data(), mask),
+			             tiledEvaluator.ndsplineeval(coords.data(), centers.data(), mask),
+			             "Evaluators for tiled and untiled tables yield identical evaluates");
+		}
+		derivatives[i%ndim]=2;
+		ENSURE_EQUAL(spline.ndsplineeval_deriv(coords.data(), centers.data(), derivatives.data()),
+		             tiled.ndsplineeval_deriv(coords.data(), centers.data(), derivatives.data()),
+		             "Tiled and untiled tables yield identical derivatives");
+		derivatives[i%ndim]=0;
+		
+		spline.ndsplineeval_gradient(coords.data(), centers.data(), gradient1.data());
+		tiled.ndsplineeval_gradient(coords.data(), centers.data(), gradient2.data());
+		for(int j=0; j<ndim+1; j++)
+			ENSURE_EQUAL(gradient1[j], gradient2[j], "Tiled and untiled tables yield identical gradients");
+		evaluator.ndsplineeval_gradient(coords.data(), centers.data(), gradient1.data());
+		tiledEvaluator.ndsplineeval_gradient(coords.data(), centers.data(), gradient2.data());
+		for(int j=0; j<ndim+1; j++)
+			ENSURE_EQUAL(gradient1[j], gradient2[j],
+			             "Evaluators for tiled and untiled tables yield identical gradients");
+	}
+	
+	try {
+		tiled.get_coefficients();
+		throw std::logic_error("Raw access should require untiled coefficients");
+	} catch (std::runtime_error &) {}
+	
+	tiled.untile_coefficients();
+	ENSURE(!tiled.is_tiled(), "Untiling should restore the standard layout");
+	ENSURE(std::equal(spline.get_coefficients(), spline.get_coefficients()+spline.get_ncoeffs(),
+	                  tiled.get_coefficients()), "Untiling should restore the original coefficients");
+}
+
+TEST(tiled_coefficients){
+	for(size_t dim=1; dim<6; dim++){
+		for(uint32_t tileSize : {1u, 2u, 3u, 5u}){
+			test_tiled_evaluation("test_data/test_spline_"+std::to_string(dim)+"d.fits", tileSize);
+			test_tiled_evaluation("test_data/test_spline_"+std::to_string(dim)+"d_nco.fits", tileSize);
+		}
+	}
+}
+
+TEST(coefficient_conversion){
+	using photospline::detail::coefficient_value;
+	using photospline::detail::store_coefficient;
+	//every half and bfloat16 value should survive a round trip through float
+	for(uint32_t bits=0; bits<(1u<<16); bits++){
+		photospline::detail::half h{uint16_t(bits)}, h2;
+		store_coefficient(coefficient_value(h), h2);
+		if(std::isnan(coefficient_value(h)))
+			ENSURE(std::isnan(coefficient_value(h2)), "NaN should remain NaN");
+		else
+			ENSURE_EQUAL(h2.bits, h.bits, "Half values should be preserved exactly");
+		photospline::detail::bfloat16 b{uint16_t(bits)}, b2;
+		store_coefficient(coefficient_value(b), b2);
+		if(std::isnan(coefficient_value(b)))
+			ENSURE(std::isnan(coefficient_value(b2)), "NaN should remain NaN");
+		else
+			ENSURE_EQUAL(b2.bits, b.bits, "Bfloat16 values should be preserved exactly");
+	}
+	ENSURE_EQUAL(coefficient_value(photospline::detail::half{0x3c00}), 1.f);
+	ENSURE_EQUAL(coefficient_value(photospline::detail::half{0x7bff}), 65504.f);
+	ENSURE_EQUAL(coefficient_value(photospline::detail::half{0x0001}), std::ldexp(1.f,-24));
+	ENSURE_EQUAL(coefficient_value(photospline::detail::bfloat16{0xc040}), -3.f);
+	
+	//other values should be rounded to the nearest, with ties to even
+	std::mt19937 rng;
+	rng.seed(71);
+	std::uniform_real_distribution<> mantissa(-1,1);
+	std::uniform_int_distribution<> exponent(-30,20);
+	for(size_t i=0; i<100000; i++){
+		float x=std::ldexp(mantissa(rng),exponent(rng));
+		//make some exact ties
+		if(i%4==0)
+			x=std::ldexp(std::round(std::ldexp(x,14))+.5,-14);
+		photospline::detail::half h;
+		store_coefficient(x, h);
+		double error=std::abs(coefficient_value(h)-(double)x);
+		for(int step : {-1, 1}){
+			if(std::abs(x)>=65520)
+				break; //overflow is checked below
+			photospline::detail::half neighbor{uint16_t(h.bits+step)};
+			if((neighbor.bits & 0x7fff) >= 0x7c00 || (neighbor.bits & 0x8000) != (h.bits & 0x8000))
+				continue;
+			double neighborError=std::abs(coefficient_value(neighbor)-(double)x);
+			ENSURE(error<neighborError || (error==neighborError && h.bits%2==0),
+			       "Values should be rounded to the nearest half, with ties to even");
+		}
+		photospline::detail::bfloat16 b;
+		store_coefficient(x, b);
+		error=std::abs(coefficient_value(b)-(double)x);
+		for(int step : {-1, 1}){
+			photospline::detail::bfloat16 neighbor{uint16_t(b.bits+step)};
+			if((neighbor.bits & 0x8000) != (b.bits & 0x8000))
+				continue;
+			double neighborError=std::abs(coefficient_value(neighbor)-(double)x);
+			ENSURE(error<neighborError || (error==neighborError && b.bits%2==0),
+			       "Values should be rounded to the nearest bfloat16, with ties to even");
+		}
+	}
+	photospline::detail::half h;
+	store_coefficient(65520., h);
+	ENSURE_EQUAL(h.bits, 0x7c00, "Values too large for a half should become infinite");
+	store_coefficient(65519., h);
+	ENSURE_EQUAL(h.bits, 0x7bff, "Values just below the overflow threshold should round down");
+}
+
+//Check that a table with coefficients stored as another type evaluates
+//exactly as a float table whose coefficients have been rounded to that type
+void test_stored_evaluation(const std::string& splinePath,
+                            photospline::coefficient_storage storage, uint32_t tileSize){
+	photospline::splinetable<> spline(splinePath);
+	photospline::splinetable<> stored(splinePath);
+	stored.set_coefficient_storage(storage);
+	if(tileSize)
+		stored.tile_coefficients(tileSize);
+	ENSURE(stored.get_coefficient_storage()==storage, "Coefficients should be stored as requested");
+	spline.set_coefficient_storage(storage);
+	spline.set_coefficient_storage(photospline::coefficient_storage::float32);
+	const bool exact=(storage!=photospline::coefficient_storage::float64);
+	if(exact)
+		ENSURE(stored==spline, "Converting should round each coefficient");
+	
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	photospline::splinetable<>::evaluator storedEvaluator=stored.get_evaluator();
+	//double coefficients are summed in double precision, which can differ
+	//noticeably from summing in float where terms cancel
+	auto check=[exact](double expected, double actual, const char* message){
+		if(exact)
+			ENSURE_EQUAL(actual, expected, message);
+		else
+			ENSURE_DISTANCE(actual, expected, 1e-3*std::max(1.,std::abs(expected)), message);
+	};
+	
+	std::mt19937 rng;
+	rng.seed(29);
+	const int ndim = spline.get_ndim();
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers(ndim);
+	std::vector<double> gradient1(ndim+1), gradient2(ndim+1);
+	for(size_t i=0; i<500; i++){
+		for(int j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		ENSURE(spline.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+		for(int d=0; d<ndim+1; d++){
+			int mask=(d<ndim ? 1<<d : 0);
+			check(spline.ndsplineeval(coords.data(), centers.data(), mask),
+			      stored.ndsplineeval(coords.data(), centers.data(), mask),
+			      "Stored coefficients should yield the same evaluates");
+			check(evaluator.ndsplineeval(coords.data(), centers.data(), mask),
+			      storedEvaluator.ndsplineeval(coords.data(), centers.data(), mask),
+			      "Evaluators with stored coefficients should yield the same evaluates");
+			ENSURE_EQUAL(stored.ndsplineeval(coords.data(), centers.data(), mask),
+			             storedEvaluator.ndsplineeval(coords.data(), centers.data(), mask),
+			             "Tables and evaluators should agree");
+		}
+		spline.ndsplineeval_gradient(coords.data(), centers.data(), gradient1.data());
+		stored.ndsplineeval_gradient(coords.data(), centers.data(), gradient2.data());
+		for(int j=0; j<ndim+1; j++)
+			check(gradient1[j], gradient2[j], "Stored coefficients should yield the same gradients");
+		evaluator.ndsplineeval_gradient(coords.data(), centers.data(), gradient1.data());
+		storedEvaluator.ndsplineeval_gradient(coords.data(), centers.data(), gradient2.data());
+		for(int j=0; j<ndim+1; j++)
+			check(gradient1[j], gradient2[j],
+			      "Evaluators with stored coefficients should yield the same gradients");
+	}
+	
+	stored.set_coefficient_storage(photospline::coefficient_storage::float32);
+	stored.untile_coefficients();
+	ENSURE(std::equal(spline.get_coefficients(), spline.get_coefficients()+spline.get_ncoeffs(),
+	                  stored.get_coefficients()), "Converting back to float should be exact");
+}
+
+TEST(coefficient_storage){
+	for(size_t dim=1; dim<6; dim++){
+		for(auto storage : {photospline::coefficient_storage::float16,
+		                    photospline::coefficient_storage::bfloat16,
+		                    photospline::coefficient_storage::float64}){
+			for(uint32_t tileSize : {0u, 3u}){
+				test_stored_evaluation("test_data/test_spline_"+std::to_string(dim)+"d.fits", storage, tileSize);
+				test_stored_evaluation("test_data/test_spline_"+std::to_string(dim)+"d_nco.fits", storage, tileSize);
+			}
+		}
+	}
+	
+	photospline::splinetable<> spline("test_data/test_spline_2d.fits");
+	spline.set_coefficient_storage(photospline::coefficient_storage::float16);
+	try {
+		spline.get_coefficients();
+		throw std::logic_error("Raw access should require float coefficients");
+	} catch (std::runtime_error &) {}
+}
+
+void test_quantized_evaluation(const std::string& splinePath,
+                               photospline::coefficient_storage storage, uint32_t tileSize){
+	photospline::splinetable<> spline(splinePath);
+	photospline::splinetable<> quantized(splinePath);
+	double maxError=quantized.quantize_coefficients(storage, tileSize);
+	ENSURE(quantized.get_coefficient_storage()==storage, "Coefficients should be quantized as requested");
+	ENSURE(quantized.is_tiled(), "Quantized coefficients should be tiled");
+	
+	//the reported error should be the largest change to any coefficient, and
+	//no more than half a quantization step for the largest tile range
+	const float* original=spline.get_coefficients();
+	float range=*std::max_element(original,original+spline.get_ncoeffs())
+	           -*std::min_element(original,original+spline.get_ncoeffs());
+	double levels=(storage==photospline::coefficient_storage::int8 ? 255 : 65535);
+	ENSURE(maxError<=1.001*range/levels/2+1e-6*range, "Quantization error should be bounded by the step size");
+	
+	photospline::splinetable<>::evaluator evaluator=quantized.get_evaluator();
+	std::mt19937 rng;
+	rng.seed(37);
+	const int ndim = spline.get_ndim();
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers(ndim);
+	std::vector<double> gradient1(ndim+1), gradient2(ndim+1);
+	for(size_t i=0; i<500; i++){
+		for(int j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		ENSURE(spline.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+		double value=spline.ndsplineeval(coords.data(), centers.data(), 0);
+		double quantizedValue=quantized.ndsplineeval(coords.data(), centers.data(), 0);
+		//allow for rounding when summing in float, as well as quantization
+		ENSURE_DISTANCE(quantizedValue, value, maxError+1e-3*std::max(1.,std::abs(value)),
+		                "Quantization should not change values by more than the reported error");
+		for(int d=0; d<ndim+1; d++){
+			int mask=(d<ndim ? 1<<d : 0);
+			ENSURE_EQUAL(evaluator.ndsplineeval(coords.data(), centers.data(), mask),
+			             quantized.ndsplineeval(coords.data(), centers.data(), mask),
+			             "Tables and evaluators should agree");
+		}
+		quantized.ndsplineeval_gradient(coords.data(), centers.data(), gradient1.data());
+		evaluator.ndsplineeval_gradient(coords.data(), centers.data(), gradient2.data());
+		ENSURE_EQUAL(gradient1[0], quantizedValue, "Gradient evaluation should yield the same value");
+		for(int j=0; j<ndim+1; j++)
+			ENSURE_EQUAL(gradient1[j], gradient2[j], "Tables and evaluators should agree on gradients");
+	}
+	
+	try {
+		quantized.untile_coefficients();
+		throw std::logic_error("Quantized coefficients should not be untiled");
+	} catch (std::runtime_error &) {}
+	
+	//decoding should reproduce the values used in evaluation
+	quantized.set_coefficient_storage(photospline::coefficient_storage::float32);
+	quantized.untile_coefficients();
+	double largestChange=0;
+	for(uint64_t i=0; i<spline.get_ncoeffs(); i++)
+		largestChange=std::max(largestChange,std::abs((double)quantized.get_coefficients()[i]-original[i]));
+	ENSURE_EQUAL(largestChange, maxError, "The reported error should be the largest change to a coefficient");
+}
+
+TEST(quantized_coefficients){
+	for(size_t dim=1; dim<6; dim++){
+		for(auto storage : {photospline::coefficient_storage::int8,
+		                    photospline::coefficient_storage::int16}){
+			for(uint32_t tileSize : {1u, 4u}){
+				test_quantized_evaluation("test_data/test_spline_"+std::to_string(dim)+"d.fits", storage, tileSize);
+				test_quantized_evaluation("test_data/test_spline_"+std::to_string(dim)+"d_nco.fits", storage, tileSize);
+			}
+		}
+	}
+	
+	photospline::splinetable<> spline("test_data/test_spline_2d.fits");
+	try {
+		spline.set_coefficient_storage(photospline::coefficient_storage::int8);
+		throw std::logic_error("Quantizing should require quantize_coefficients");
+	} catch (std::runtime_error &) {}
+	ENSURE(spline.get_coefficient_storage()==photospline::coefficient_storage::float32,
+	       "A failed conversion should leave the coefficients unchanged");
+}
+
+TEST(registered_evaluation_kernels){
+	//a table with mixed orders
+	photospline::splinetable<> spline("test_data/test_spline_2d.fits");
+	std::vector<photospline::splinetable<>*> tables(8,&spline);
+	std::vector<double> coordinates;
+	for(size_t i=0; i<tables.size(); i++)
+		coordinates.push_back(i);
+	photospline::splinetable<> stacked(tables,coordinates,3);
+	ENSURE_EQUAL(stacked.get_order(0), 2u);
+	ENSURE_EQUAL(stacked.get_order(1), 2u);
+	ENSURE_EQUAL(stacked.get_order(2), 3u);
+	
+	test_evaluator_interface(stacked);
+	bool registered=photospline::splinetable<>::register_evaluation_kernels<2,2,3>();
+	ENSURE(registered, "Kernels should be registered for new orders");
+	registered=photospline::splinetable<>::register_evaluation_kernels<2,2,3>();
+	ENSURE(!registered, "Kernels should only be registered once for the same orders");
+	test_evaluator_interface(stacked);
+	
+	//registered kernels for tables too wide for one vector should also be
+	//used for gradients, in place of the wide kernels for their dimension
+	photospline::splinetable<> spline4("test_data/test_spline_4d.fits");
+	std::vector<photospline::splinetable<>*> tables4(8,&spline4);
+	photospline::splinetable<> stacked5(tables4,coordinates,3);
+	photospline::splinetable<>::evaluator baseline=stacked5.get_evaluator(photospline::simd_variant::generic);
+	registered=photospline::splinetable<>::register_evaluation_kernels<2,2,2,2,3>();
+	ENSURE(registered, "Kernels should be registered for new orders");
+	photospline::splinetable<>::evaluator evaluator=stacked5.get_evaluator();
+	ENSURE(evaluator.get_simd_variant()==baseline.get_simd_variant(),
+	       "Registered kernels should not be replaced by wide kernels");
+	test_evaluator_interface(stacked5);
+}
+
+void test_hessian_evaluation(const std::string& splinePath){
+	photospline::splinetable<> spline(splinePath);
+	const int ndim = spline.get_ndim();
+	ENSURE_EQUAL(spline.hessian_size(), 1u+ndim+ndim*(ndim+1)/2);
+	photospline::splinetable<> stored(splinePath);
+	stored.tile_coefficients(3);
+	stored.set_coefficient_storage(photospline::coefficient_storage::float64);
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	photospline::splinetable<>::evaluator storedEvaluator=stored.get_evaluator();
+	
+	std::mt19937 rng;
+	rng.seed(57);
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers(ndim);
+	std::vector<unsigned int> derivatives(ndim);
+	std::vector<double> hessian1(spline.hessian_size()), hessian2(spline.hessian_size());
+	for(size_t i=0; i<1000; i++){
+		for(int j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		ENSURE(spline.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+		
+		spline.ndsplineeval_hessian(coords.data(), centers.data(), hessian1.data());
+		//compare each quantity to the derivative computed alone
+		size_t k=0;
+		auto check=[&](double value, double tolerance){
+			ENSURE_DISTANCE(hessian1[k], value, tolerance*std::max(1.,std::abs(value)),
+			                "ndsplineeval_hessian() and ndsplineeval_deriv() should agree");
+			k++;
+		};
+		check(spline.ndsplineeval(coords.data(), centers.data(), 0), 1e-5);
+		for(int a=0; a<ndim; a++){
+			std::fill(derivatives.begin(), derivatives.end(), 0);
+			derivatives[a]=1;
+			check(spline.ndsplineeval_deriv(coords.data(), centers.data(), derivatives.data()), 1e-4);
+		}
+		for(int a=0; a<ndim; a++){
+			for(int b=a; b<ndim; b++){
+				std::fill(derivatives.begin(), derivatives.end(), 0);
+				derivatives[a]++;
+				derivatives[b]++;
+				check(spline.ndsplineeval_deriv(coords.data(), centers.data(), derivatives.data()), 1e-4);
+			}
+		}
+		
+		evaluator.ndsplineeval_hessian(coords.data(), centers.data(), hessian2.data());
+		for(size_t j=0; j<hessian1.size(); j++)
+			ENSURE_EQUAL(hessian1[j], hessian2[j], "Table and evaluator yield identical Hessians");
+		stored.ndsplineeval_hessian(coords.data(), centers.data(), hessian2.data());
+		for(size_t j=0; j<hessian1.size(); j++)
+			ENSURE_DISTANCE(hessian1[j], hessian2[j], 1e-3*std::max(1.,std::abs(hessian1[j])),
+			                "Tiled double coefficients yield the same Hessian");
+		storedEvaluator.ndsplineeval_hessian(coords.data(), centers.data(), hessian1.data());
+		for(size_t j=0; j<hessian1.size(); j++)
+			ENSURE_EQUAL(hessian1[j], hessian2[j], "Table and evaluator yield identical Hessians");
+	}
+}
+
+TEST(hessian_evaluation){
+	test_hessian_evaluation("test_data/test_spline_1d.fits");
+	test_hessian_evaluation("test_data/test_spline_2d.fits");
+	test_hessian_evaluation("test_data/test_spline_3d.fits");
+	test_hessian_evaluation("test_data/test_spline_4d.fits");
+	test_hessian_evaluation("test_data/test_spline_5d.fits");
+}
+
+TEST(high_dimensional_gradient){
+	//build a 9 dimensional table by stacking copies of a smaller one, and
+	//make its coefficients vary in every dimension
+	std::unique_ptr<photospline::splinetable<>> spline(new photospline::splinetable<>("test_data/test_spline_1d.fits"));
+	while(spline->get_ndim()<9){
+		std::vector<photospline::splinetable<>*> tables(3,spline.get());
+		std::vector<double> coordinates={0,1,2};
+		spline.reset(new photospline::splinetable<>(tables,coordinates));
+	}
+	std::mt19937 rng;
+	rng.seed(91);
+	std::uniform_real_distribution<float> coefficientDist(-1,1);
+	for(size_t i=0; i<spline->get_ncoeffs(); i++)
+		spline->get_coefficients()[i]+=coefficientDist(rng);
+	const int ndim = spline->get_ndim();
+	
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline->lower_extent(i),spline->upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers(ndim);
+	std::vector<double> gradient1(ndim+1), gradient2(ndim+1);
+	for(auto variant : {photospline::simd_variant::generic,photospline::simd_variant::avx2,photospline::simd_variant::avx512}){
+		photospline::splinetable<>::evaluator evaluator=spline->get_evaluator(variant);
+		for(size_t i=0; i<200; i++){
+			for(int j=0; j<ndim; j++)
+				coords[j]=dists[j](rng);
+			ENSURE(spline->searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+			
+			spline->ndsplineeval_gradient(coords.data(), centers.data(), gradient1.data());
+			evaluator.ndsplineeval_gradient(coords.data(), centers.data(), gradient2.data());
+			for(int j=0; j<ndim+1; j++){
+				double expected=spline->ndsplineeval(coords.data(), centers.data(), j ? 1<<(j-1) : 0);
+				ENSURE_DISTANCE(gradient1[j], expected, 1e-4*std::max(1.,std::abs(expected)),
+				                "ndsplineeval_gradient() and ndsplineeval() should agree");
+				ENSURE_DISTANCE(gradient2[j], expected, 1e-4*std::max(1.,std::abs(expected)),
+				                "Evaluators should agree with ndsplineeval()");
+			}
+		}
+	}
+}
+
+TEST(multiple_derivatives){
+	for(size_t dim=1; dim<6; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		const int ndim = spline.get_ndim();
+		photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+		
+		std::mt19937 rng;
+		rng.seed(63);
+		std::vector<std::uniform_real_distribution<>> dists;
+		for(int i=0; i<ndim; i++)
+			dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+		
+		//every combination of first derivatives, and a short list such as
+		//the value and a single derivative
+		std::vector<int> allMasks;
+		for(int mask=0; mask<(1<<ndim); mask++)
+			allMasks.push_back(mask);
+		std::vector<int> fewMasks={0,1<<(ndim-1)};
+		
+		std::vector<double> coords(ndim);
+		std::vector<int> centers(ndim);
+		std::vector<double> results1(allMasks.size()), results2(allMasks.size());
+		for(size_t i=0; i<1000; i++){
+			for(int j=0; j<ndim; j++)
+				coords[j]=dists[j](rng);
+			ENSURE(spline.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+			
+			for(const std::vector<int>& masks : {allMasks,fewMasks}){
+				spline.ndsplineeval_multi(coords.data(), centers.data(), masks.data(), masks.size(), results1.data());
+				evaluator.ndsplineeval_multi(coords.data(), centers.data(), masks.data(), masks.size(), results2.data());
+				for(size_t j=0; j<masks.size(); j++){
+					double expected=spline.ndsplineeval(coords.data(), centers.data(), masks[j]);
+					ENSURE_DISTANCE(results1[j], expected, 1e-4*std::max(1.,std::abs(expected)),
+					                "ndsplineeval_multi() and ndsplineeval() should agree");
+					ENSURE_EQUAL(results1[j], results2[j], "Table and evaluator yield identical results");
+				}
+			}
+		}
+	}
+}
+
+TEST(table_group){
+	photospline::splinetable<> spline1("test_data/test_spline_3d.fits");
+	photospline::splinetable<> spline2("test_data/test_spline_3d.fits");
+	for(size_t i=0; i<spline2.get_ncoeffs(); i++)
+		spline2.get_coefficients()[i]=2*spline2.get_coefficients()[i]+1;
+	photospline::splinetable<> spline3("test_data/test_spline_3d.fits");
+	spline3.tile_coefficients(3);
+	spline3.set_coefficient_storage(photospline::coefficient_storage::float16);
+	//double precision tables are evaluated in double precision
+	photospline::splinetable<> spline4("test_data/test_spline_3d.fits");
+	spline4.set_coefficient_storage(photospline::coefficient_storage::float64);
+	std::vector<const photospline::splinetable<>*> tables={&spline1,&spline2,&spline3,&spline4};
+	photospline::splinetable<>::table_group group(tables);
+	ENSURE_EQUAL(group.size(), 4u);
+	const int ndim = spline1.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(71);
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline1.lower_extent(i),spline1.upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	std::vector<int> centers(ndim);
+	std::vector<double> results(tables.size());
+	for(size_t i=0; i<1000; i++){
+		for(int j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		ENSURE(group.searchcenters(coords.data(), centers.data()), "Center lookup should succeed");
+		for(int mask=0; mask<(1<<ndim); mask++){
+			group.ndsplineeval(coords.data(), centers.data(), results.data(), mask);
+			for(size_t t=0; t<tables.size(); t++)
+				ENSURE_EQUAL(results[t], tables[t]->ndsplineeval(coords.data(), centers.data(), mask),
+				             "Tables in a group should evaluate as they do alone");
+		}
+	}
+	
+	//points outside the tables yield zeros
+	for(int j=0; j<ndim; j++)
+		coords[j]=spline1.upper_extent(j)+1;
+	group(coords.data(), results.data());
+	for(size_t t=0; t<tables.size(); t++)
+		ENSURE_EQUAL(results[t], 0, "Tables should be zero outside their extents");
+	
+	//tables with different knots cannot be grouped
+	photospline::splinetable<> other("test_data/test_spline_2d.fits");
+	tables.push_back(&other);
+	try {
+		photospline::splinetable<>::table_group badGroup(tables);
+		throw std::logic_error("Grouping incompatible tables should be rejected");
+	} catch (std::runtime_error &) {}
+}
+
+void test_cursor(const photospline::splinetable<>& spline){
+	const int ndim = spline.get_ndim();
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	
+	std::mt19937 rng;
+	rng.seed(83);
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(int i=0; i<ndim; i++)
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+	
+	std::vector<double> coords(ndim);
+	for(int mask : {0,1<<(ndim-1),(1<<ndim)-1}){
+		photospline::splinetable<>::evaluator::cursor cursor(evaluator,mask);
+		ENSURE_EQUAL(cursor.evaluate(), 0, "A cursor with no coordinates should yield zero");
+		for(int j=0; j<ndim; j++)
+			coords[j]=dists[j](rng);
+		ENSURE(cursor.set_coordinates(coords.data()), "Coordinates should be inside the table");
+		ENSURE_EQUAL(cursor.evaluate(), evaluator(coords.data(),mask),
+		             "Cursors should evaluate as the evaluator does");
+		//scan each dimension in turn, and occasionally move all of them
+		for(size_t i=0; i<2000; i++){
+			if(i%100==0){
+				for(int j=0; j<ndim; j++)
+					coords[j]=dists[j](rng);
+				ENSURE_EQUAL(cursor(coords.data()), evaluator(coords.data(),mask),
+				             "Cursors should evaluate as the evaluator does");
+				continue;
+			}
+			int dim=(i/100)%ndim;
+			coords[dim]=dists[dim](rng);
+			ENSURE(cursor.set_coordinate(dim,coords[dim]), "Coordinates should be inside the table");
+			ENSURE_EQUAL(cursor.evaluate(), evaluator(coords.data(),mask),
+			             "Cursors should evaluate as the evaluator does");
+		}
+		//moving outside the table and back
+		double saved=coords[0];
+		ENSURE(!cursor.set_coordinate(0,spline.upper_extent(0)+1), "Coordinates should be outside the table");
+		ENSURE_EQUAL(cursor.evaluate(), 0, "Cursors should yield zero outside the table");
+		ENSURE(cursor.set_coordinate(0,saved), "Coordinates should be inside the table");
+		ENSURE_EQUAL(cursor.evaluate(), evaluator(coords.data(),mask),
+		             "Cursors should evaluate as the evaluator does");
+	}
+}
+
+TEST(evaluation_cursor){
+	for(size_t dim=1; dim<6; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		test_cursor(spline);
+		spline.tile_coefficients(3);
+		spline.set_coefficient_storage(photospline::coefficient_storage::float16);
+		test_cursor(spline);
+	}
+}
+
+void test_dense_grideval(const photospline::splinetable<>& spline){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const size_t ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(64);
+	
+	//cover a region slightly larger than the support of the spline, so that
+	//some grid points fall outside of it
+	std::vector<std::vector<double>> coords(ndim);
+	size_t npoints=1;
+	for(size_t i=0; i<ndim; i++){
+		double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+		std::uniform_real_distribution<> dist(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin);
+		coords[i].resize(ndim<3 ? 40 : 7+i);
+		for(double& x : coords[i])
+			x=dist(rng);
+		npoints*=coords[i].size();
+	}
+	
+	std::vector<double> results(npoints), point(ndim);
+	std::vector<int> centers(ndim);
+	for(int derivatives : {0, 1, 1<<(ndim-1)}){
+		spline.grideval_dense(coords, results.data(), derivatives);
+		double scale=0;
+		for(double r : results)
+			scale=std::max(scale,std::abs(r));
+		for(size_t k=0; k<npoints; k++){
+			size_t index=k;
+			for(size_t i=ndim; i-->0; ){
+				point[i]=coords[i][index%coords[i].size()];
+				index/=coords[i].size();
+			}
+			double evaluate=0;
+			if(evaluator.searchcenters(point.data(), centers.data()))
+				evaluate=evaluator.ndsplineeval(point.data(), centers.data(), derivatives);
+			//the evaluator sums in single precision, so where terms cancel its
+			//error is relative to their size rather than to the result
+			ENSURE_DISTANCE(results[k],evaluate,1e-5*std::max(std::abs(evaluate),scale)+1e-6,
+			                "grideval_dense() and evaluator::ndsplineeval() should agree");
+		}
+	}
+}
+
+TEST(dense_grideval){
+	for(size_t dim=1; dim<6; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		test_dense_grideval(spline);
+		//the coefficients may be stored in any layout
+		spline.quantize_coefficients(photospline::coefficient_storage::int16);
+		test_dense_grideval(spline);
+	}
+	
+	photospline::splinetable<> spline("test_data/test_spline_2d.fits");
+	std::vector<double> results(1);
+	try{
+		spline.grideval_dense(std::vector<std::vector<double>>(1,std::vector<double>(1,0.)), results.data());
+		throw std::logic_error("grideval_dense should reject the wrong number of coordinate vectors");
+	}catch(std::runtime_error&){}
+}
+
+void test_polynomial_evaluator(const photospline::splinetable<>& spline){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	photospline::splinetable<>::polynomial_evaluator polynomial(spline);
+	const size_t ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(65);
+	
+	//include points outside the support of the spline
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(size_t i=0; i<ndim; i++){
+		double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin));
+	}
+	
+	const size_t npoints=1000;
+	std::vector<double> points(npoints*ndim);
+	for(size_t k=0; k<npoints*ndim; k++)
+		points[k]=dists[k%ndim](rng);
+	std::vector<int> centers(ndim);
+	for(int derivatives : {0, 1, 1<<(ndim-1)}){
+		std::vector<double> expected(npoints);
+		double scale=0;
+		for(size_t k=0; k<npoints; k++){
+			if(evaluator.searchcenters(&points[k*ndim], centers.data()))
+				expected[k]=evaluator.ndsplineeval(&points[k*ndim], centers.data(), derivatives);
+			scale=std::max(scale,std::abs(expected[k]));
+		}
+		for(size_t k=0; k<npoints; k++){
+			//the evaluator sums in single precision, so where terms cancel its
+			//error is relative to their size rather than to the result
+			ENSURE_DISTANCE(polynomial(&points[k*ndim], derivatives),expected[k],
+			                1e-5*std::max(std::abs(expected[k]),scale)+1e-6,
+			                "polynomial_evaluator and evaluator should agree");
+		}
+	}
+	
+	photospline::splinetable<>::polynomial_evaluator::tradeoff report=polynomial.compare(1000);
+	ENSURE(report.polynomial_bytes>report.table_bytes,
+	       "Polynomials need more memory than the table's coefficients");
+	ENSURE(report.table_eval_rate>0 && report.polynomial_eval_rate>0);
+}
+
+TEST(polynomial_evaluator){
+	for(size_t dim=1; dim<5; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		test_polynomial_evaluator(spline);
+	}
+	//the coefficients may be stored in any layout
+	photospline::splinetable<> spline("test_data/test_spline_3d.fits");
+	spline.quantize_coefficients(photospline::coefficient_storage::int16);
+	test_polynomial_evaluator(spline);
+}
+
+template<typename StaticEvaluator>
+void test_static_evaluator(const photospline::splinetable<>& spline, const StaticEvaluator& fixed){
+	photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+	const size_t ndim = spline.get_ndim();
+	
+	std::mt19937 rng;
+	rng.seed(66);
+	
+	std::vector<std::uniform_real_distribution<>> dists;
+	for(size_t i=0; i<ndim; i++){
+		double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+		dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin));
+	}
+	
+	std::vector<double> point(ndim);
+	std::vector<int> centers(ndim), fixedCenters(ndim);
+	for(size_t k=0; k<1000; k++){
+		for(size_t i=0; i<ndim; i++)
+			point[i]=dists[i](rng);
+		bool inside=evaluator.searchcenters(point.data(), centers.data());
+		ENSURE_EQUAL(fixed.searchcenters(point.data(), fixedCenters.data()),inside,
+		             "static_evaluator and evaluator should agree on which points are in the table");
+		if(!inside)
+			continue;
+		ENSURE(centers==fixedCenters, "static_evaluator and evaluator should find the same centers");
+		for(int derivatives : {0, 1, 1<<(ndim-1)}){
+			double expected=evaluator.ndsplineeval(point.data(), centers.data(), derivatives);
+			ENSURE_DISTANCE(fixed(point.data(), derivatives),expected,1e-6*std::abs(expected)+1e-6,
+			                "static_evaluator and evaluator should agree");
+		}
+	}
+}
+
+TEST(static_evaluator){
+	{
+		photospline::splinetable<> spline("test_data/test_spline_1d.fits");
+		test_static_evaluator(spline, spline.get_static_evaluator<2>());
+	}
+	{
+		photospline::splinetable<> spline("test_data/test_spline_2d.fits");
+		test_static_evaluator(spline, spline.get_static_evaluator<2,2>());
+	}
+	
+	photospline::splinetable<> spline("test_data/test_spline_3d.fits");
+	test_static_evaluator(spline, spline.get_static_evaluator<2,2,2>());
+	
+	try{
+		spline.get_static_evaluator<2,2>();
+		throw std::logic_error("get_static_evaluator should reject the wrong number of dimensions");
+	}catch(std::runtime_error&){}
+	try{
+		spline.get_static_evaluator<2,3,2>();
+		throw std::logic_error("get_static_evaluator should reject the wrong orders");
+	}catch(std::runtime_error&){}
+	spline.quantize_coefficients(photospline::coefficient_storage::int16);
+	try{
+		spline.get_static_evaluator<2,2,2>();
+		throw std::logic_error("get_static_evaluator should reject converted coefficients");
+	}catch(std::runtime_error&){}
+}
+
+TEST(basis_rows){
+	for(size_t dim=1; dim<5; dim++){
+		photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d.fits");
+		photospline::splinetable<>::evaluator evaluator=spline.get_evaluator();
+		const size_t ndim = spline.get_ndim();
+		const float* coefficients = spline.get_coefficients();
+		const uint64_t size = evaluator.basis_row_size();
+		
+		std::mt19937 rng;
+		rng.seed(67);
+		const size_t npoints=500;
+		std::vector<std::vector<double>> coords(ndim, std::vector<double>(npoints));
+		std::vector<const double*> coordPtrs(ndim);
+		for(size_t i=0; i<ndim; i++){
+			double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+			std::uniform_real_distribution<> dist(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin);
+			for(double& x : coords[i])
+				x=dist(rng);
+			coordPtrs[i]=coords[i].data();
+		}
+		
+		std::vector<uint64_t> rowStarts(npoints+1), columns(npoints*size);
+		std::vector<double> values(npoints*size), point(ndim);
+		std::vector<int> centers(ndim);
+		for(int derivatives : {0, 1}){
+			evaluator.basis_rows(coordPtrs.data(), npoints, rowStarts.data(), columns.data(), values.data(), derivatives);
+			ENSURE_EQUAL(rowStarts[0],0u);
+			for(size_t p=0; p<npoints; p++){
+				for(size_t i=0; i<ndim; i++)
+					point[i]=coords[i][p];
+				bool inside=evaluator.searchcenters(point.data(), centers.data());
+				ENSURE_EQUAL(rowStarts[p+1]-rowStarts[p],(inside ? size : 0u),
+				             "Rows should hold every supporting coefficient, or none outside the table");
+				if(!inside)
+					continue;
+				double sum=0, scale=0;
+				for(uint64_t k=rowStarts[p]; k<rowStarts[p+1]; k++){
+					ENSURE(columns[k]<spline.get_ncoeffs());
+					if(k>rowStarts[p])
+						ENSURE(columns[k]>columns[k-1], "Indices should increase along each row");
+					sum+=values[k]*coefficients[columns[k]];
+					scale+=std::abs(values[k]*coefficients[columns[k]]);
+				}
+				double expected=evaluator.ndsplineeval(point.data(), centers.data(), derivatives);
+				ENSURE_DISTANCE(sum,expected,1e-5*scale+1e-6,
+				                "Basis rows applied to the coefficients should give the spline");
+			}
+		}
+	}
+}
+
+TEST(basis_across_dimensions){
+	//evaluators may compute the bases of several dimensions together, which
+	//should match the table computing them one dimension at a time exactly
+	for(size_t dim=1; dim<6; dim++){
+		for(std::string suffix : {"", "_nco"}){
+			photospline::splinetable<> spline("test_data/test_spline_"+std::to_string(dim)+"d"+suffix+".fits");
+			const size_t ndim = spline.get_ndim();
+			
+			std::mt19937 rng;
+			rng.seed(71);
+			std::vector<std::uniform_real_distribution<>> dists;
+			for(size_t i=0; i<ndim; i++){
+				double margin=.05*(spline.upper_extent(i)-spline.lower_extent(i));
+				dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i)-margin,spline.upper_extent(i)+margin));
+			}
+			std::vector<double> point(ndim);
+			std::vector<int> centers(ndim);
+			for(auto variant : {photospline::simd_variant::generic,photospline::simd_variant::avx512}){
+				photospline::splinetable<>::evaluator evaluator=spline.get_evaluator(variant);
+				for(size_t p=0; p<1000; p++){
+					for(size_t i=0; i<ndim; i++)
+						point[i]=dists[i](rng);
+					if(!evaluator.searchcenters(point.data(), centers.data()))
+						continue;
+					for(int derivatives : {0, 1, (1<<ndim)-1}){
+						double expected=spline.ndsplineeval(point.data(), centers.data(), derivatives);
+						ENSURE_EQUAL(evaluator.ndsplineeval(point.data(), centers.data(), derivatives),expected,
+						             "Evaluators should compute the same bases as the table");
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(evaluator_knot_reciprocals){
+	for(std::string name : {"2d", "3d", "4d_nco", "5d_nco"}){
+		photospline::splinetable<> spline("test_data/test_spline_"+name+".fits");
+		const size_t ndim = spline.get_ndim();
+		
+		std::mt19937 rng;
+		rng.seed(72);
+		std::vector<std::uniform_real_distribution<>> dists;
+		for(size_t i=0; i<ndim; i++)
+			dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+		std::vector<double> point(ndim);
+		std::vector<int> centers(ndim);
+		std::vector<double> expected_gradient(ndim+1), gradient(ndim+1);
+		for(auto variant : {photospline::simd_variant::generic,photospline::simd_variant::avx512}){
+			photospline::splinetable<>::evaluator evaluator=spline.get_evaluator(variant);
+			ENSURE(!evaluator.uses_knot_reciprocals());
+			evaluator.use_knot_reciprocals();
+			ENSURE(evaluator.uses_knot_reciprocals());
+			for(size_t p=0; p<1000; p++){
+				for(size_t i=0; i<ndim; i++)
+					point[i]=dists[i](rng);
+				if(!evaluator.searchcenters(point.data(), centers.data()))
+					continue;
+				for(int derivatives : {0, 1}){
+					double expected=spline.ndsplineeval(point.data(), centers.data(), derivatives);
+					ENSURE_DISTANCE(evaluator.ndsplineeval(point.data(), centers.data(), derivatives),expected,
+					                1e-5*(1+std::abs(expected)));
+				}
+				spline.ndsplineeval_gradient(point.data(), centers.data(), expected_gradient.data());
+				evaluator.ndsplineeval_gradient(point.data(), centers.data(), gradient.data());
+				for(size_t i=0; i<=ndim; i++)
+					ENSURE_DISTANCE(gradient[i],expected_gradient[i],1e-5*(1+std::abs(expected_gradient[i])));
+			}
+			
+			//batches compute the same bases as single points
+			const size_t npoints=101;
+			std::vector<std::vector<double>> coords(ndim,std::vector<double>(npoints));
+			std::vector<const double*> coordPtrs(ndim);
+			for(size_t i=0; i<ndim; i++){
+				for(size_t p=0; p<npoints; p++)
+					coords[i][p]=dists[i](rng);
+				coordPtrs[i]=coords[i].data();
+			}
+			std::vector<double> results(npoints);
+			for(int derivatives : {0, 1}){
+				evaluator.ndsplineeval_batch(coordPtrs.data(), npoints, results.data(), derivatives);
+				for(size_t p=0; p<npoints; p++){
+					for(size_t i=0; i<ndim; i++)
+						point[i]=coords[i][p];
+					ENSURE_EQUAL(results[p], evaluator(point.data(), derivatives),
+					             "Batches should use the division-free bases");
+				}
+			}
+			
+			//as do cursors and groups of tables
+			std::vector<const photospline::splinetable<>*> tables={&spline};
+			photospline::splinetable<>::table_group group(tables);
+			group.use_knot_reciprocals();
+			ENSURE(group.uses_knot_reciprocals());
+			for(int derivatives : {0, 1}){
+				photospline::splinetable<>::evaluator::cursor cursor(evaluator,derivatives);
+				for(size_t p=0; p<npoints; p++){
+					for(size_t i=0; i<ndim; i++)
+						point[i]=coords[i][p];
+					if(!evaluator.searchcenters(point.data(), centers.data()))
+						continue;
+					double expected=spline.ndsplineeval(point.data(), centers.data(), derivatives);
+					ENSURE_DISTANCE(cursor(point.data()),expected,1e-5*(1+std::abs(expected)));
+					group.ndsplineeval(point.data(), centers.data(), results.data(), derivatives);
+					ENSURE_DISTANCE(results[0],expected,1e-5*(1+std::abs(expected)));
+				}
+			}
+			
+			evaluator.use_knot_reciprocals(false);
+			ENSURE(!evaluator.uses_knot_reciprocals());
+		}
+	}
+}
+
+TEST(tensor_train){
+	for(std::string name : {"1d", "2d", "3d", "4d_nco", "5d"}){
+		photospline::splinetable<> spline("test_data/test_spline_"+name+".fits");
+		const size_t ndim = spline.get_ndim();
+		
+		//make the coefficients a sum of a few separable terms, which the
+		//decomposition should find with small ranks
+		float* coefficients = spline.get_coefficients();
+		for(uint64_t k=0; k<spline.get_ncoeffs(); k++){
+			uint64_t rest = k;
+			double product = 1, sum = 0;
+			for(size_t i=ndim; i-- > 0; ){
+				double index = rest%spline.get_ncoeffs(i);
+				rest /= spline.get_ncoeffs(i);
+				product *= std::exp(-0.01*index*index);
+				sum += std::sin(0.3*(i+1)*index);
+			}
+			coefficients[k] = product + 0.1*sum;
+		}
+		
+		std::mt19937 rng;
+		rng.seed(73);
+		std::vector<std::uniform_real_distribution<>> dists;
+		for(size_t i=0; i<ndim; i++)
+			dists.push_back(std::uniform_real_distribution<>(spline.lower_extent(i),spline.upper_extent(i)));
+		std::vector<double> point(ndim);
+		std::vector<int> centers(ndim);
+		photospline::splinetable<>::evaluator evaluator = spline.get_evaluator();
+		
+		for(double tolerance : {0., 1e-3, 0.1}){
+			photospline::splinetable<>::tensor_train train(spline, tolerance);
+			ENSURE_EQUAL(train.get_rank(0), 1u);
+			ENSURE_EQUAL(train.get_rank(ndim), 1u);
+			for(size_t i=1; i<ndim; i++)
+				ENSURE(train.get_rank(i)<=3, "A sum of separable terms should need small ranks");
+			ENSURE(train.error_bound()<=std::max(tolerance,1e-5));
+			if(ndim>2)
+				ENSURE(train.memory_usage()<spline.get_ncoeffs()*sizeof(float)/4);
+			
+			for(size_t p=0; p<1000; p++){
+				for(size_t i=0; i<ndim; i++)
+					point[i]=dists[i](rng);
+				ENSURE(train.searchcenters(point.data(), centers.data()));
+				//the change to the coefficients bounds that to the values
+				double expected=evaluator.ndsplineeval(point.data(), centers.data());
+				ENSURE_DISTANCE(train.ndsplineeval(point.data(), centers.data()), expected,
+				                train.error_bound()+1e-5);
+				ENSURE_DISTANCE(train(point.data()), expected, train.error_bound()+1e-5);
+				if(tolerance==0){
+					expected=evaluator.ndsplineeval(point.data(), centers.data(), 1);
+					ENSURE_DISTANCE(train.ndsplineeval(point.data(), centers.data(), 1), expected,
+					                1e-4*(1+std::abs(expected)));
+				}
+			}
+		}
+		
+		//limiting the rank gives up accuracy, which is reported
+		if(ndim>1){
+			photospline::splinetable<>::tensor_train train(spline, 0, 1);
+			for(size_t i=0; i<=ndim; i++)
+				ENSURE_EQUAL(train.get_rank(i), 1u);
+			ENSURE(train.error_bound()>1e-3);
+			for(size_t p=0; p<1000; p++){
+				for(size_t i=0; i<ndim; i++)
+					point[i]=dists[i](rng);
+				evaluator.searchcenters(point.data(), centers.data());
+				ENSURE_DISTANCE(train.ndsplineeval(point.data(), centers.data()),
+				                evaluator.ndsplineeval(point.data(), centers.data()),
+				                train.error_bound()+1e-5);
+			}
+		}
+	}
+	
+	photospline::splinetable<> spline("test_data/test_spline_3d.fits");
+	try{
+		photospline::splinetable<>::tensor_train train(spline, -1);
+		throw std::logic_error("A negative tolerance should be rejected");
+	}catch(std::runtime_error&){}
+	try{
+		photospline::splinetable<>::tensor_train train(spline, 0, 0);
+		throw std::logic_error("A rank of zero should be rejected");
+	}catch(std::runtime_error&){}
+}
@@ -71,6 +71,60 @@ TEST(write_fits_spline){
 	unlink("write_test_spline.fits");
 }
 
+TEST(write_fits_tiled_spline){
+	photospline::splinetable<> spline("test_data/test_spline_4d.fits");
+	photospline::splinetable<> tiled("test_data/test_spline_4d.fits");
+	tiled.tile_coefficients(3);
+	
+	tiled.write_fits("write_test_spline.fits");
+	photospline::splinetable<> spline2("write_test_spline.fits");
+	ENSURE(!spline2.is_tiled(), "Splines should be read with the standard layout");
+	compare_splines(spline,spline2);
+	
+	unlink("write_test_spline.fits");
+}
+
+TEST(write_fits_stored_spline){
+	//half precision coefficients are written as floats, which are read back
+	//exactly
+	photospline::splinetable<> rounded("test_data/test_spline_4d.fits");
+	rounded.set_coefficient_storage(photospline::coefficient_storage::float16);
+	rounded.write_fits("write_test_spline.fits");
+	rounded.set_coefficient_storage(photospline::coefficient_storage::float32);
+	photospline::splinetable<> spline2("write_test_spline.fits");
+	compare_splines(rounded,spline2);
+	photospline::splinetable<> spline3;
+	spline3.read_fits("write_test_spline.fits",photospline::coefficient_storage::float16);
+	ENSURE(spline3.get_coefficient_storage()==photospline::coefficient_storage::float16,
+	       "Coefficients should be converted as they are read");
+	ENSURE(spline3==rounded, "Converting half precision coefficients should be exact");
+	unlink("write_test_spline.fits");
+	
+	//double precision coefficients are written as doubles
+	photospline::splinetable<> spline("test_data/test_spline_4d.fits");
+	photospline::splinetable<> precise;
+	precise.read_fits("test_data/test_spline_4d.fits",photospline::coefficient_storage::float64);
+	ENSURE(precise==spline, "Converting to double precision should be exact");
+	precise.write_fits("write_test_spline.fits");
+	photospline::splinetable<> precise2;
+	precise2.read_fits("write_test_spline.fits",photospline::coefficient_storage::float64);
+	ENSURE(precise2==precise, "Double precision coefficients should survive a round trip");
+	unlink("write_test_spline.fits");
+}
+
+TEST(write_fits_quantized_spline){
+	//quantized coefficients are written as the floats they decode to
+	photospline::splinetable<> quantized("test_data/test_spline_4d.fits");
+	quantized.quantize_coefficients(photospline::coefficient_storage::int8);
+	quantized.write_fits("write_test_spline.fits");
+	photospline::splinetable<> spline2("write_test_spline.fits");
+	ENSURE(spline2==quantized, "Quantized coefficients should be written as decoded");
+	quantized.set_coefficient_storage(photospline::coefficient_storage::float32);
+	quantized.untile_coefficients();
+	compare_splines(quantized,spline2);
+	unlink("write_test_spline.fits");
+}
+
 TEST(fits_mem_spline){
 	photospline::splinetable<> spline("test_data/test_spline_4d.fits");
 	spline.write_key("SHORTKEY",123);